@@ -2,26 +2,116 @@
  * Copyright 2021-2024 Bull SAS
  */
 
+#include <string.h>
+
+#include "env.h"
+#include "log.h"
+#include "topo.h"
 #include "binding.h"
 #include "intel_binding.h"
 #include "hwloc_binding.h"
+#include "sched_binding.h"
+
+struct binding_ops {
+    const char *name;
+    void (*get_thread_affinity)(struct sys_bind_data *data);
+    int (*set_thread_affinity)(struct sys_bind_data *data);
+    void (*sys_bind_data_alloc)(struct sys_bind_data *data);
+    void (*sys_bind_data_free)(struct sys_bind_data *data);
+};
+
+static const struct binding_ops binding_backends[BINDING_NUM_BACKENDS] = {
+    {
+        "sched",
+        sabo_sched_get_thread_affinity,
+        sabo_sched_set_thread_affinity,
+        sabo_sched_sys_bind_data_alloc,
+        sabo_sched_sys_bind_data_free
+    },
+    {
+        "hwloc",
+        sabo_hwloc_get_thread_affinity,
+        sabo_hwloc_set_thread_affinity,
+        sabo_hwloc_sys_bind_data_alloc,
+        sabo_hwloc_sys_bind_data_free
+    }
+};
+
+static enum binding_backend sabo_binding_backend = BINDING_BACKEND_SCHED;
+static const struct binding_ops *sabo_binding =
+    &(binding_backends[BINDING_BACKEND_SCHED]);
+
+/* The sched backend binds with a fixed size cpu_set_t */
+static int sabo_binding_fits_cpu_set(hwloc_topology_t topo)
+{
+    return (CPU_SETSIZE >
+        hwloc_bitmap_last(hwloc_topology_get_complete_cpuset(topo)));
+}
+
+/* Select the backend before any thread binding data is allocated, the data
+ * of a backend are not understood by the others. The core masks are only
+ * valid for the running system, hwloc does not bind threads on a topology
+ * loaded from another node, nor on the cpus above CPU_SETSIZE */
+void sabo_binding_init(void)
+{
+    char string[16];
+    hwloc_topology_t topo = topo_get_hwloc_topology();
+
+    sabo_binding_backend = BINDING_BACKEND_SCHED;
+    if (NULL == topo || !hwloc_topology_is_thissystem(topo) ||
+        !sabo_binding_fits_cpu_set(topo))
+        sabo_binding_backend = BINDING_BACKEND_HWLOC;
+
+    env_get_binding(string, sizeof(string));
+    if ('\0' != string[0]) {
+        int i;
+
+        for (i = 0; i < BINDING_NUM_BACKENDS; i++) {
+            if (0 == strcmp(string, binding_backends[i].name))
+                break;
+        }
+
+        if (BINDING_NUM_BACKENDS == i)
+            error("Unknown binding backend '%s'", string);
+        else if (BINDING_BACKEND_SCHED == i && NULL != topo &&
+             !sabo_binding_fits_cpu_set(topo))
+            error("Binding backend '%s' needs cpus below %d", string,
+                  CPU_SETSIZE);
+        else
+            sabo_binding_backend = (enum binding_backend) i;
+    }
+
+    sabo_binding = &(binding_backends[sabo_binding_backend]);
+
+    debug(LOG_DEBUG_BINDING, "Binding backend %s", sabo_binding->name);
+}
+
+enum binding_backend sabo_binding_get_backend(void)
+{
+    return sabo_binding_backend;
+}
 
 void sabo_get_thread_affinity(struct sys_bind_data *data)
 {
-    sabo_hwloc_get_thread_affinity(data);
+    sabo_binding->get_thread_affinity(data);
 }
 
+/* A failed move keeps the thread dirty on its current core */
 void sabo_set_thread_affinity(struct sys_bind_data *data)
 {
-    sabo_hwloc_set_thread_affinity(data);
+    if (!data->dirty)
+        return;
+
+    if (0 == sabo_binding->set_thread_affinity(data))
+        data->dirty = 0;
 }
 
 void sabo_sys_bind_data_alloc(struct sys_bind_data *data)
 {
-    sabo_hwloc_sys_bind_data_alloc(data);
+    sabo_binding->sys_bind_data_alloc(data);
 }
 
 void sabo_sys_bind_data_free(struct sys_bind_data *data)
 {
-    sabo_hwloc_sys_bind_data_free(data);
+    sabo_binding->sys_bind_data_free(data);
 }
@@ -5,12 +5,27 @@
 #ifndef __include_binding_h
 #define __include_binding_h
 
+/* Thread binding implementations, selected once by sabo_binding_init */
+enum binding_backend {
+    BINDING_BACKEND_SCHED = 0,  /* sched_setaffinity on the core masks */
+    BINDING_BACKEND_HWLOC,      /* hwloc thread cpubind */
+    BINDING_NUM_BACKENDS
+};
+
 struct sys_bind_data {
     int cur_core_id;
     int new_core_id;
+    /* Last binding generation applied by the omp thread */
+    int generation;
+    /* The new core differs from the current one, clean threads are not
+     * rebound */
+    int dirty;
     void *data;
 };
 
+void sabo_binding_init(void);
+enum binding_backend sabo_binding_get_backend(void);
+
 void sabo_get_thread_affinity(struct sys_bind_data *data);
 void sabo_set_thread_affinity(struct sys_bind_data *data);
 void sabo_sys_bind_data_alloc(struct sys_bind_data *data);
@@ -7,8 +7,12 @@
 #include <assert.h>
 #include <string.h>
 #include <limits.h>
+#include <inttypes.h>
+
+#include "omp.h"
 
 #include "decision_tree.h"
+#include "env.h"
 #include "list.h"
 #include "log.h"
 #include "sabo_internal.h"
@@ -18,6 +22,44 @@
 
 #define DECISION_NODE_THRESHOLD 64
 
+/* Parallel solver: subproblems targeted per solver thread and maximum
+ * number of subproblems built from the top levels of the tree */
+#define DECISION_TASKS_PER_THREAD 8
+#define DECISION_MAX_TASKS 512
+
+/* Transposition table: number of slots (power of two) per solver thread and
+ * slots probed from the hashed one */
+#define DECISION_TT_NUM_SLOTS (1 << 14)
+#define DECISION_TT_NUM_PROBES 4
+
+/* Smaller subtrees are cheaper to explore than to look up */
+#define DECISION_TT_MIN_REMAINING 2
+
+/* Placement cache entry layout: the number of processes, requested num
+ * threads and move cost baseline of each process, then the placement */
+#define DECISION_CACHE_HEADER 1
+#define DECISION_CACHE_NUM_KEYS 2
+
+/* Exact solver: initial number of slots (power of two). The automatic solver
+ * selection uses it up to a number of sockets, the pruned backtracking is
+ * faster above, and up to a number of states */
+#define DECISION_DP_NUM_SLOTS (1 << 10)
+#define DECISION_DP_MAX_SOCKETS 3
+#define DECISION_DP_MAX_STATES (1 << 18)
+
+/* Exact solver slot layout, followed by the state key */
+#define DECISION_DP_GENERATION 0
+#define DECISION_DP_NORME 1
+#define DECISION_DP_MOVE_COST 2
+#define DECISION_DP_HEADER 3
+
+/* Transposition table slot layout, followed by the sorted free cores */
+#define DECISION_TT_GENERATION 0
+#define DECISION_TT_DEPTH 1
+#define DECISION_TT_NORME 2
+#define DECISION_TT_MOVE_COST 3
+#define DECISION_TT_HEADER 4
+
 struct tree_process {
     /* Speed-up core_processes update */
     struct core_process *core_process;
@@ -38,39 +80,210 @@ struct tree_node {
     struct list_node list_node;
 
     /* node info */
-    int min;
     int norme;
-    int num_socket_changes;
+    int move_cost;
     int placed_num_processes;
 
     /* debug info */
     int depth;
-    int pad0;
 
     /* Actual state on node */
     struct tree_process *processes;
 
     /* Socket data */
     struct tree_socket_data *data;
+};
+
+/* Backtracking solver undo log entry (one per tree depth) */
+struct tree_undo {
+    int socket_id;
+    int num_threads;
+    int norme;
+    int move_cost;
+    int num_free_capacity;
+};
+
+/* Backtracking solver mutable state */
+struct tree_state {
+    /* Socket id of placed processes */
+    int *socket_ids;
+
+    /* Socket free cores */
+    int *num_free_cores;
+
+    struct tree_undo *undo;
+
+    int norme;
+    int move_cost;
+    int placed_num_processes;
+
+    /* Free cores of sockets that are not oversubscribed */
+    int num_free_capacity;
+};
+
+/* Best norme and move cost of a subtree */
+struct tree_bound {
+    int norme;
+    int move_cost;
+};
+
+/* Complete placement */
+struct tree_candidate {
+    int *socket_ids;
+    int norme;
+    int move_cost;
+    int found;
+    int pad0;
+};
+
+/* Per solver thread exploration state */
+struct tree_search {
+    struct listm_head free_nodes;
+    int num_free_nodes;
+    int pad0;
+
+    /* Node copying solver best candidate */
+    struct tree_node *best_node;
+
+    /* Backtracking solver state */
+    struct tree_state state;
 
     /* Best candidate */
-    struct tree_node *best;
+    struct tree_candidate best;
 
-    /* Node father */
-    struct tree_node *father;
+    /* Transposition table slots and sorted free cores of each depth */
+    int *tt_slots;
+    int *tt_keys;
+    int *tt_sorted;
+
+    /* Free cores of sockets too small for the next process */
+    int *bound_sorted;
+
+    struct decision_tree_stats stats;
+
+    /* Time spent in subproblems */
+    double elapsed;
+};
+
+/* Subproblem of the parallel solver */
+struct tree_task {
+    /* Socket id of the first tasks_depth placed processes */
+    int *prefix;
+
+    /* Best candidate of the subproblem */
+    struct tree_candidate best;
 };
 
 struct tree_ctx {
     int num_sockets;
     int num_cores_per_socket;
+    int num_threads;
+
+    /* Processes to place, the arrays are sized for the most processes */
     int num_processes;
-    int num_free_nodes;
+    int max_processes;
+
+    /* Cores of each socket, num_cores_per_socket unless set otherwise */
+    int *num_cores;
+    int total_num_cores;
+
+    /* Socket changes are weighted by the cost of moving a process from its
+     * prev_socket_id, indexed [prev_socket_id * num_sockets + socket_id].
+     * Processes without a valid prev_socket_id cost the cheapest move. Only
+     * uniform costs keep the sockets interchangeable */
+    int uniform_costs;
+    int *move_costs;
+    int *min_move_costs;
+    int no_prev_cost;
+    int pad3;
+
+    /* Best norme found so far, shared between solver threads */
+    int min;
+    int num_tasks;
+    int tasks_depth;
+
+    /* Requested solver and the solver it resolves to, the automatic
+     * selection is resolved again when the sockets or the budget change */
+    int requested_solver;
+    int solver;
+
+    int flags;
+
+    /* Transposition table slots of older placements are ignored */
+    int tt_generation;
+
+    /* Explored nodes before returning the best candidate found, 0 for an
+     * exhaustive search */
+    int budget;
+    int budget_exhausted;
+
+    /* Incremental placement: requested num threads and placement of the
+     * previous call, indexed like the core processes. The placement is the
+     * move cost baseline of the next call. It is only reused as is
+     * when it comes from a search that was not stopped by the budget */
+    int last_valid;
+    int last_exact;
+    int *last_num_threads;
+    int *last_socket_ids;
+
+    /* Previous placement replayed on the sorted processes */
+    struct tree_candidate incumbent;
+
+    /* Placement of the current call indexed like the core processes */
+    int *placement;
+
+    /* Exact solver best value of each state, slots of older placements are
+     * ignored. Keys of each depth are the number of placed processes and the
+     * free cores of each socket */
+    int dp_generation;
+    int dp_num_slots;
+    int dp_num_states;
+    int pad2;
+    int *dp_slots;
+    int *dp_keys;
+
+    /* LRU placement cache, an entry is empty when its stamp is 0 */
+    int cache_size;
+    int pad1;
+    int *cache_key;
+    int *cache_entries;
+    uint64_t *cache_hashes;
+    uint64_t *cache_stamps;
+    uint64_t cache_clock;
+    uint64_t cache_lookups;
+    uint64_t cache_hits;
+
+    /* Processes sorted by requested num threads */
+    struct tree_process *processes;
 
-    struct listm_head free_nodes;
+    /* Symmetry breaking: process has the same num_threads and
+     * prev_socket_id than the previous one */
+    int *same_as_prev;
+
+    /* Symmetry breaking: last process index with socket as prev_socket_id */
+    int *last_prev_idx;
+
+    /* Bound: threads of processes from index to the last one */
+    int *remaining_threads;
+
+    /* Bound: processes from index to the last one without valid
+     * prev_socket_id, and with each socket as prev_socket_id */
+    int *remaining_no_prev;
+    int *remaining_prev;
+
+    struct tree_search *searches;
+    struct tree_task *tasks;
 };
 
 static struct tree_ctx *__sabo_tree_ctx = NULL;
 
+static const char *tree_solver_names[DECISION_TREE_NUM_SOLVERS] = {
+    "copy",
+    "backtrack",
+    "dp",
+    "auto"
+};
+
 static void tree_init_node(struct tree_node *node, const int num_sockets,
                const int num_processes)
 {
@@ -90,36 +303,37 @@ static void tree_fini_node(struct tree_node *node)
     xfree(node->data);
 }
 
-static struct tree_node *tree_alloc_node(void)
+static struct tree_node *tree_alloc_node(struct tree_search *search)
 {
     void *ptr;
     struct tree_node *node;
 
-    ptr = listm_get_first(&(__sabo_tree_ctx->free_nodes));
+    ptr = listm_get_first(&(search->free_nodes));
     node = (struct tree_node *) ptr;
 
     if(likely(NULL != node)) {
-        listm_remove(&(__sabo_tree_ctx->free_nodes), (void *) node);
+        listm_remove(&(search->free_nodes), (void *) node);
         assert(NULL != node->processes);
-        __sabo_tree_ctx->num_free_nodes--;
+        search->num_free_nodes--;
     } else { /* Allocate new node */
         node = xzalloc(sizeof(struct tree_node));
         tree_init_node(node, __sabo_tree_ctx->num_sockets,
-                   __sabo_tree_ctx->num_processes);
+                   __sabo_tree_ctx->max_processes);
+        search->stats.num_allocs++;
     }
 
     return node;
 }
 
-static void tree_free_node(struct tree_node *node)
+static void tree_free_node(struct tree_search *search, struct tree_node *node)
 {
     if (unlikely(NULL == node)) /* mimic free behaviours */
         return;
 
     /* Add first to minimize default page on tree_alloc_node */
-    if(likely(DECISION_NODE_THRESHOLD > __sabo_tree_ctx->num_free_nodes)) {
-        listm_add_first(&(__sabo_tree_ctx->free_nodes), (void *) node);
-        __sabo_tree_ctx->num_free_nodes++;
+    if(likely(DECISION_NODE_THRESHOLD > search->num_free_nodes)) {
+        listm_add_first(&(search->free_nodes), (void *) node);
+        search->num_free_nodes++;
         return;
     }
 
@@ -127,35 +341,116 @@ static void tree_free_node(struct tree_node *node)
     xfree(node);
 }
 
-void tree_init_nodes_list(const int num_sockets, const int num_processes);
-
-void tree_init_nodes_list(const int num_sockets, const int num_processes)
+static void tree_init_nodes_list(struct tree_search *search,
+                 const int num_sockets, const int num_processes)
 {
     const size_t offset = LIST_OFFSET(struct tree_node, list_node);
 
-    listm_head_init(&(__sabo_tree_ctx->free_nodes), offset);
+    listm_head_init(&(search->free_nodes), offset);
 
-    __sabo_tree_ctx->num_free_nodes = 0;
+    search->num_free_nodes = 0;
 
     for (int i = 0; i < DECISION_NODE_THRESHOLD; i++) {
         struct tree_node *node = xzalloc(sizeof(struct tree_node));
         tree_init_node(node, num_sockets, num_processes);
-        tree_free_node(node);    /* Add to free node pool    */
+        tree_free_node(search, node);    /* Add to free node pool    */
     }
 }
 
-static void tree_fini_nodes_list(void)
+static void tree_fini_nodes_list(struct tree_search *search)
 {
     void *ptr;
 
-    if (NULL == __sabo_tree_ctx)
-        return;
-
-    while (NULL != (ptr = listm_get_first(&(__sabo_tree_ctx->free_nodes)))) {
-        listm_remove(&(__sabo_tree_ctx->free_nodes), ptr);
+    while (NULL != (ptr = listm_get_first(&(search->free_nodes)))) {
+        listm_remove(&(search->free_nodes), ptr);
         tree_fini_node((struct tree_node *) ptr);
         xfree(ptr);
     }
+
+    search->num_free_nodes = 0;
+}
+
+static void tree_init_candidate(struct tree_candidate *candidate,
+                const int num_processes)
+{
+    candidate->socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+    candidate->found = 0;
+}
+
+static void tree_fini_candidate(struct tree_candidate *candidate)
+{
+    xfree(candidate->socket_ids);
+    candidate->socket_ids = NULL;
+}
+
+static void tree_copy_candidate(struct tree_candidate *dst,
+                const struct tree_candidate *src)
+{
+    dst->found = src->found;
+    if (!src->found)
+        return;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++)
+        dst->socket_ids[i] = src->socket_ids[i];
+
+    dst->norme = src->norme;
+    dst->move_cost = src->move_cost;
+}
+
+static void tree_init_state(struct tree_state *state, const int num_sockets,
+                const int num_processes)
+{
+    void *ptr;
+
+    state->socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+    state->num_free_cores = xzalloc(sizeof(int) * (size_t) num_sockets);
+
+    ptr = xzalloc(sizeof(struct tree_undo) * (size_t) num_processes);
+    state->undo = (struct tree_undo *) ptr;
+}
+
+static void tree_fini_state(struct tree_state *state)
+{
+    xfree(state->socket_ids);
+    xfree(state->num_free_cores);
+    xfree(state->undo);
+}
+
+static void tree_init_search(struct tree_search *search, const int prealloc)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int num_processes = __sabo_tree_ctx->max_processes;
+    const size_t offset = LIST_OFFSET(struct tree_node, list_node);
+
+    /* Only the main solver thread got a pre-allocated pool */
+    if (prealloc) {
+        tree_init_nodes_list(search, num_sockets, num_processes);
+    } else {
+        listm_head_init(&(search->free_nodes), offset);
+    }
+
+    search->best_node = NULL;
+
+    tree_init_state(&(search->state), num_sockets, num_processes);
+    tree_init_candidate(&(search->best), num_processes);
+
+    search->tt_slots = xzalloc(sizeof(int) * DECISION_TT_NUM_SLOTS *
+                   (size_t) (DECISION_TT_HEADER + num_sockets));
+    search->tt_keys = xzalloc(sizeof(int) * (size_t) num_processes *
+                  (size_t) num_sockets);
+    search->tt_sorted = xzalloc(sizeof(int) * (size_t) num_sockets);
+    search->bound_sorted = xzalloc(sizeof(int) * (size_t) num_sockets);
+}
+
+static void tree_fini_search(struct tree_search *search)
+{
+    tree_fini_nodes_list(search);
+    tree_fini_state(&(search->state));
+    tree_fini_candidate(&(search->best));
+    xfree(search->tt_slots);
+    xfree(search->tt_keys);
+    xfree(search->tt_sorted);
+    xfree(search->bound_sorted);
 }
 
 /* Sorted processes by num_threads */
@@ -166,54 +461,117 @@ static int tree_cmp_processes_by_num_threads(void const *ptr1, void const *ptr2)
     return p1->num_threads - p2->num_threads;
 }
 
-static void tree_sort_processes_by_num_threads(struct tree_node *node)
+static void tree_sort_processes_by_num_threads(struct tree_process *processes)
 {
-    qsort(node->processes, (size_t) __sabo_tree_ctx->num_processes,
+    qsort(processes, (size_t) __sabo_tree_ctx->num_processes,
           sizeof(struct tree_process), tree_cmp_processes_by_num_threads);
 }
 
-static struct tree_node *tree_alloc_root_node(struct core_process *processes)
+/* The previous placement is the move cost baseline */
+static int tree_is_incremental(void)
 {
-    struct tree_node *root;
-
-    root = tree_alloc_node();
-
-    root->min = INT_MIN;
-    root->norme = INT_MIN;
-    root->father = NULL;
-    root->best = NULL;
-    root->num_socket_changes = 0;
-    root->placed_num_processes = 0;
-
-    root->depth = 0;
+    return (__sabo_tree_ctx->flags & DECISION_TREE_FLAG_INCREMENTAL &&
+        __sabo_tree_ctx->last_valid) ? 1 : 0;
+}
 
-    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
-           root->data[i].num_free_cores = __sabo_tree_ctx->num_cores_per_socket;
+/* Suffix sums of the sorted processes used by the placement bound */
+static void tree_init_remaining(void)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int num_processes = __sabo_tree_ctx->num_processes;
+    int *remaining_prev = __sabo_tree_ctx->remaining_prev;
+
+    __sabo_tree_ctx->remaining_threads[num_processes] = 0;
+    __sabo_tree_ctx->remaining_no_prev[num_processes] = 0;
+    for (int i = 0; i < num_sockets; i++)
+        remaining_prev[num_processes * num_sockets + i] = 0;
+
+    for (int i = num_processes - 1; 0 <= i; i--) {
+        const struct tree_process *process = &(__sabo_tree_ctx->processes[i]);
+        const int prev_socket_id = process->prev_socket_id;
+
+        __sabo_tree_ctx->remaining_threads[i] =
+            __sabo_tree_ctx->remaining_threads[i + 1] +
+            process->num_threads;
+
+        __sabo_tree_ctx->remaining_no_prev[i] =
+            __sabo_tree_ctx->remaining_no_prev[i + 1];
+
+        for (int j = 0; j < num_sockets; j++)
+            remaining_prev[i * num_sockets + j] =
+                remaining_prev[(i + 1) * num_sockets + j];
+
+        if (0 <= prev_socket_id && num_sockets > prev_socket_id)
+            remaining_prev[i * num_sockets + prev_socket_id]++;
+        else
+            __sabo_tree_ctx->remaining_no_prev[i]++;
+    }
+}
 
+static void tree_init_processes(struct core_process *processes)
+{
     /* Copy core_process datas */
     for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
-        struct tree_process *tree_process = &(root->processes[i]);
+        struct tree_process *tree_process = &(__sabo_tree_ctx->processes[i]);
 
         /* Copy data */
         tree_process->num_threads = processes[i].num_threads;
         tree_process->prev_socket_id = processes[i].prev_socket_id;
+        if (tree_is_incremental())
+            tree_process->prev_socket_id = __sabo_tree_ctx->last_socket_ids[i];
         tree_process->socket_id = -1;    /* undefined value */
         tree_process->rank =  processes[i].node_rank;
         tree_process->core_process = &(processes[i]);
     }
 
     /* Sort process by requested num threads */
-    tree_sort_processes_by_num_threads(root);
+    tree_sort_processes_by_num_threads(__sabo_tree_ctx->processes);
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
+        __sabo_tree_ctx->last_prev_idx[i] = -1;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        const struct tree_process *process = &(__sabo_tree_ctx->processes[i]);
+        const struct tree_process *prev = process - 1;
+
+        __sabo_tree_ctx->same_as_prev[i] = (0 < i &&
+            prev->num_threads == process->num_threads &&
+            prev->prev_socket_id == process->prev_socket_id) ? 1 : 0;
+
+        if (0 <= process->prev_socket_id &&
+            __sabo_tree_ctx->num_sockets > process->prev_socket_id)
+            __sabo_tree_ctx->last_prev_idx[process->prev_socket_id] = i;
+    }
+
+    tree_init_remaining();
+}
+
+static struct tree_node *tree_alloc_root_node(struct tree_search *search)
+{
+    struct tree_node *root;
+
+    root = tree_alloc_node(search);
+
+    root->norme = INT_MIN;
+    root->move_cost = 0;
+    root->placed_num_processes = 0;
+
+    root->depth = 0;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
+           root->data[i].num_free_cores = __sabo_tree_ctx->num_cores[i];
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++)
+        root->processes[i] = __sabo_tree_ctx->processes[i];
 
     return root;
 }
 
 static struct tree_node *tree_dup_node(struct tree_node *dup_node,
-                       struct tree_node *node)
+                       const struct tree_node *node)
 {
-    dup_node->min = node->min;
     dup_node->norme = node->norme;
-    dup_node->num_socket_changes = node->num_socket_changes;
+    dup_node->move_cost = node->move_cost;
     dup_node->placed_num_processes = node->placed_num_processes;
 
     dup_node->depth = node->depth + 1;
@@ -226,12 +584,24 @@ static struct tree_node *tree_dup_node(struct tree_node *dup_node,
     for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
         dup_node->data[i] = node->data[i];
 
-    dup_node->best = NULL;
-    dup_node->father = node;
-
     return dup_node;
 }
 
+/* Socket changes weight of a process placement */
+static inline int tree_move_cost(const int prev_socket_id, const int socket_id)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+
+    if (prev_socket_id == socket_id)
+        return 0;
+
+    if (0 > prev_socket_id || num_sockets <= prev_socket_id)
+        return __sabo_tree_ctx->no_prev_cost;
+
+    return __sabo_tree_ctx->move_costs[prev_socket_id * num_sockets +
+                       socket_id];
+}
+
 static void tree_update_node(struct tree_node *node, const int socket_id)
 {
     struct tree_process *process;
@@ -247,8 +617,8 @@ static void tree_update_node(struct tree_node *node, const int socket_id)
     debug(LOG_DEBUG_DECISION_TREE, "Place process #%d on socket #%d",
            process->rank, socket_id);
 
-    if (process->prev_socket_id != socket_id)
-        node->num_socket_changes++;
+    node->move_cost += tree_move_cost(process->prev_socket_id,
+                           socket_id);
 
     if (0 < node->data[socket_id].num_free_cores)
         return;
@@ -260,182 +630,1911 @@ static void tree_update_node(struct tree_node *node, const int socket_id)
     }
 }
 
+static void tree_reset_state(struct tree_state *state)
+{
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
+        state->num_free_cores[i] = __sabo_tree_ctx->num_cores[i];
+
+    state->norme = INT_MIN;
+    state->move_cost = 0;
+    state->placed_num_processes = 0;
+    state->num_free_capacity = __sabo_tree_ctx->total_num_cores;
+}
+
+/* Place next unassigned process, same counters as tree_update_node */
+static void tree_apply_state(struct tree_state *state, const int socket_id)
+{
+    int num_free_cores;
+    struct tree_undo *undo;
+    const struct tree_process *process;
+
+    const int idx = state->placed_num_processes;
+
+    process = &(__sabo_tree_ctx->processes[idx]);
+
+    /* Save counters overwritten by the placement */
+    undo = &(state->undo[idx]);
+    undo->socket_id = socket_id;
+    undo->num_threads = process->num_threads;
+    undo->norme = state->norme;
+    undo->move_cost = state->move_cost;
+    undo->num_free_capacity = state->num_free_capacity;
+
+    /* Sockets are never placed once oversubscribed */
+    state->num_free_capacity -= MIN(state->num_free_cores[socket_id],
+                    process->num_threads);
+
+    state->num_free_cores[socket_id] -= process->num_threads;
+    state->socket_ids[idx] = socket_id;
+    state->placed_num_processes++;
+
+    debug(LOG_DEBUG_DECISION_TREE, "Place process #%d on socket #%d",
+           process->rank, socket_id);
+
+    state->move_cost += tree_move_cost(process->prev_socket_id,
+                            socket_id);
+
+    num_free_cores = state->num_free_cores[socket_id];
+    if (0 < num_free_cores)
+        return;
+
+    if (INT_MIN == state->norme) { /* never update */
+        state->norme = num_free_cores;
+    } else {
+        state->norme += num_free_cores;
+    }
+}
+
+/* Cancel last placement */
+static void tree_undo_state(struct tree_state *state)
+{
+    const struct tree_undo *undo;
+
+    state->placed_num_processes--;
+
+    undo = &(state->undo[state->placed_num_processes]);
+    state->num_free_cores[undo->socket_id] += undo->num_threads;
+    state->norme = undo->norme;
+    state->move_cost = undo->move_cost;
+    state->num_free_capacity = undo->num_free_capacity;
+}
+
 #ifndef NDEBUG
-static void tree_dump_placement(struct tree_node *node)
+static void tree_dump_placement(const struct tree_candidate *candidate)
 {
-    debug(LOG_DEBUG_DECISION_TREE, "%s (node: %p norme: %d)",
-          __func__, (void *) node, node->norme);
+    debug(LOG_DEBUG_DECISION_TREE, "%s (norme: %d move cost: %d)",
+          __func__, candidate->norme, candidate->move_cost);
 
     for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
         debug(LOG_DEBUG_DECISION_TREE, "process #%d socket #%d",
-              node->processes[i].rank,
-              node->processes[i].socket_id);
+              __sabo_tree_ctx->processes[i].rank,
+              candidate->socket_ids[i]);
     }
 
 }
 #endif /*# ifndef NDEBUG */
 
-static void tree_build_tree_recursive(struct tree_node *node)
+/* Candidates are ordered by norme then by the fewest thread migration,
+ * ties keep the first candidate found in depth-first order */
+static int tree_is_better(const int norme, const int move_cost,
+              const struct tree_candidate *best)
 {
-    struct tree_node *child_node = tree_alloc_node();
+    if (!best->found)
+        return 1;
 
-    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
-        int remaining;
-        struct tree_node *tmp;
+    if (norme != best->norme)
+        return (norme > best->norme) ? 1 : 0;
 
-        if (unlikely(NULL == child_node))
-               child_node = tree_alloc_node();
+    return (move_cost < best->move_cost) ? 1 : 0;
+}
 
-        if (0 > node->data[i].num_free_cores)
-            continue;
+static int tree_bound_is_better(const struct tree_bound *bound,
+                const struct tree_bound *max)
+{
+    if (bound->norme != max->norme)
+        return (bound->norme > max->norme) ? 1 : 0;
 
-        /* Create child node */
-        child_node = tree_dup_node(child_node, node);
+    return (bound->move_cost < max->move_cost) ? 1 : 0;
+}
 
-        /* Update information with process placement */
-        tree_update_node(child_node, i);
+static void tree_update_min(const int norme)
+{
+    int min;
+    int *ptr = &(__sabo_tree_ctx->min);
+
+    min = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+    while (norme > min) {
+        if (__atomic_compare_exchange_n(ptr, &min, norme, 0,
+                        __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED))
+            break;
+    }
+}
 
-        /* Cut tree decision exploration */
-        if (child_node->norme != INT_MIN &&
-            child_node->norme < node->min) {
-            continue; /* skip */
-        }
+/* Cut tree decision exploration, the bound may come from another solver
+ * thread */
+static int tree_cut(const int norme)
+{
+    int min;
 
-        /* Compute remaining processes */
-        remaining = __sabo_tree_ctx->num_processes;
-        remaining -= child_node->placed_num_processes;
+    if (INT_MIN == norme)
+        return 0;
 
-        /* Skip leaf recusive call */
-        if (0 != remaining)
-            tree_build_tree_recursive(child_node);
+    min = __atomic_load_n(&(__sabo_tree_ctx->min), __ATOMIC_RELAXED);
 
-        if (0 != remaining) /* cancel exploration */
-            continue;
+    return (norme < min) ? 1 : 0;
+}
 
-        /* Valid solution */
-        child_node->min = child_node->norme;
+/* Upper bound of the norme added by the remaining processes. A socket adds
+ * at most its final free cores once it is full, so the remaining processes
+ * add at most the free capacity minus their threads. Sockets with less
+ * free cores than the smallest remaining process either stay unused or
+ * get oversubscribed by at least the difference: they are added by
+ * decreasing free cores as long as it improves the bound */
+static int tree_bound_remaining_norme(struct tree_search *search)
+{
+    int *sorted;
+    int num_sorted = 0;
+    int num_big_cores;
+    int small_cores = 0;
+    int small_norme = 0;
+    int max;
+
+    const struct tree_state *state = &(search->state);
+    const int idx = state->placed_num_processes;
+    const int num_threads = __sabo_tree_ctx->processes[idx].num_threads;
+    const int demand = __sabo_tree_ctx->remaining_threads[idx];
+
+    /* Insertion sort by decreasing free cores, few sockets */
+    sorted = search->bound_sorted;
+    num_big_cores = state->num_free_capacity;
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        const int num_free_cores = state->num_free_cores[i];
+        int j = num_sorted;
 
-        /* Free non candidate node */
-        if (child_node->min < node->min)
+        if (0 >= num_free_cores || num_threads <= num_free_cores)
             continue;
 
-        /* Keep candidate with the fewest thread migration */
-        if (node->best &&
-            child_node->num_socket_changes >= node->best->num_socket_changes)
-            continue;
+        num_big_cores -= num_free_cores;
 
-#ifndef NDEBUG
-        tree_dump_placement(child_node);
-#endif /*# ifndef NDEBUG */
+        while (0 < j && sorted[j - 1] < num_free_cores) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = num_free_cores;
+        num_sorted++;
+    }
 
-        debug(LOG_DEBUG_DECISION_TREE, "depth: %d replace %p by %p",
-              node->depth, (void *) node->best, (void *) child_node);
+    max = MIN(0, num_big_cores - demand);
+    for (int i = 0; i < num_sorted; i++) {
+        small_cores += sorted[i];
+        small_norme += sorted[i] - num_threads;
 
-        /* Found a new candidate */
-        tmp = node->best;
+        max = MAX(max, MIN(small_norme, small_cores + num_big_cores - demand));
+    }
 
-        node->best = child_node;
-        node->min = child_node->min;
-        node->num_socket_changes = child_node->num_socket_changes;
+    return max;
+}
 
-        child_node = tmp;
+/* Lower bound of the move cost: processes without a valid
+ * prev_socket_id or whose prev_socket_id is oversubscribed must move, at
+ * least to the closest socket */
+static int tree_bound_move_cost(const struct tree_state *state)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int idx = state->placed_num_processes;
+    const int *remaining_prev =
+        &(__sabo_tree_ctx->remaining_prev[idx * num_sockets]);
+    int move_cost = state->move_cost +
+        __sabo_tree_ctx->remaining_no_prev[idx] *
+        __sabo_tree_ctx->no_prev_cost;
+
+    for (int i = 0; i < num_sockets; i++) {
+        if (0 > state->num_free_cores[i])
+            move_cost += remaining_prev[i] *
+                __sabo_tree_ctx->min_move_costs[i];
     }
 
-    tree_free_node(child_node);
+    return move_cost;
+}
 
-    if (NULL == node->father)
-        return; /* Nothing to do */
+/* Cut the subtree below the state when the bound of its norme is worse than
+ * the shared bound, when it can not beat the best candidate of the solver
+ * thread or when it is worse than the previous placement. The bound is
+ * admissible, the returned candidate is unchanged */
+static int tree_bound_cut(struct tree_search *search)
+{
+    int norme;
 
-    /* Free non candidate node */
-    if (node->father->min >= node->min) {
-        tree_free_node(node->best);
-        return;
-    }
+    const struct tree_state *state = &(search->state);
+    const struct tree_candidate *best = &(search->best);
+    const struct tree_candidate *incumbent = &(__sabo_tree_ctx->incumbent);
 
-    debug(LOG_DEBUG_DECISION_TREE, "depth: %d replace %p by %p",
-          node->father->depth, (void *) node->father->best,
-          (void *) node->best);
+    if (!(__sabo_tree_ctx->flags & DECISION_TREE_FLAG_BOUND) ||
+        __sabo_tree_ctx->num_processes == state->placed_num_processes)
+        return tree_cut(state->norme);
 
-    /* Found a new candidate */
-    tree_free_node(node->father->best);
-    node->father->min = node->min;
-    node->father->best = node->best;
-}
+    /* The norme gets defined if the bound is negative */
+    norme = tree_bound_remaining_norme(search);
+    if (INT_MIN != state->norme)
+        norme += state->norme;
 
-static void tree_update_core_processes_list(struct tree_node *node)
-{
-    assert(node->placed_num_processes == __sabo_tree_ctx->num_processes);
+    if (!tree_cut(norme) &&
+        (!best->found || norme > best->norme ||
+         tree_bound_move_cost(state) < best->move_cost) &&
+        (!incumbent->found || norme > incumbent->norme ||
+         tree_bound_move_cost(state) <= incumbent->move_cost))
+        return 0;
 
-    /* Swap prev_socket_id with socket id for core processes */
-    for (int i = 0; i < node->placed_num_processes; i++) {
-        struct tree_process *tree_process = &(node->processes[i]);
-        const int socket_id = tree_process->core_process->socket_id;
+    if (!tree_cut(state->norme))
+        search->stats.num_bound_cuts++;
 
-        assert(tree_process->socket_id >= 0);
-        tree_process->core_process->socket_id = tree_process->socket_id;
-        tree_process->core_process->prev_socket_id = socket_id;
-    }
+    return 1;
 }
 
-void decision_tree_compute_placement(struct core_process *processes)
+static void tree_build_tree_recursive(struct tree_search *search,
+                      struct tree_node *node)
 {
-    struct tree_node *root;
+    struct tree_node *child_node = NULL;
 
-#ifndef NDEBUG
-    const double start = sabo_omp_get_wtime();
-#endif /* #ifndef NDEBUG */
+    const size_t num_copy_bytes =
+        sizeof(struct tree_process) * (size_t) __sabo_tree_ctx->num_processes +
+        sizeof(struct tree_socket_data) * (size_t) __sabo_tree_ctx->num_sockets;
 
-    /* Allocate and initialize root node */
-    root = tree_alloc_root_node(processes);
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        struct tree_node *best;
 
-    /* Find best candidate */
-    tree_build_tree_recursive(root);
-    if (unlikely(NULL == root->best)) {
-        error("num_socket: %d", __sabo_tree_ctx->num_sockets);
-        error("num_cores_per_socket: %d", __sabo_tree_ctx->num_cores_per_socket);
-        error("num_processes: %d", __sabo_tree_ctx->num_processes);
-        for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
-            error("process #%d num_threads: %d",
-                  processes[i].node_rank, processes[i].num_threads);
+        if (0 > node->data[i].num_free_cores)
+            continue;
+
+        if (unlikely(NULL == child_node))
+            child_node = tree_alloc_node(search);
+
+        /* Create child node */
+        child_node = tree_dup_node(child_node, node);
+
+        search->stats.num_nodes++;
+        search->stats.num_copy_bytes += num_copy_bytes;
+
+        /* Update information with process placement */
+        tree_update_node(child_node, i);
+
+        if (tree_cut(child_node->norme))
+            continue; /* skip */
+
+        /* Skip leaf recusive call */
+        if (__sabo_tree_ctx->num_processes !=
+            child_node->placed_num_processes) {
+            tree_build_tree_recursive(search, child_node);
+            continue;
         }
-        fatal_error("Failed to compute solution");
-    }
 
-#ifndef NDEBUG
-    tree_dump_placement(root->best);
-#endif /* #ifndef NDEBUG */
+        /* Valid solution, keep it only if it is a better candidate */
+        best = search->best_node;
+        if (best && (best->norme > child_node->norme ||
+                 (best->norme == child_node->norme &&
+                  best->move_cost <=
+                  child_node->move_cost)))
+            continue;
 
-    /* Store compute processes list */
-    tree_update_core_processes_list(root->best);
+        debug(LOG_DEBUG_DECISION_TREE, "depth: %d replace %p by %p",
+              node->depth, (void *) best, (void *) child_node);
+
+        /* Found a new candidate */
+        search->best_node = child_node;
+        search->stats.num_candidates++;
+        tree_update_min(child_node->norme);
 
-    /* Free root node */
-    tree_free_node(root->best);
-    tree_free_node(root);
+        child_node = best;
+    }
 
-#ifndef NDEBUG
-    debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s)",
-          __func__, (sabo_omp_get_wtime() - start) * 1000000);
-#endif /* #ifndef NDEBUG */
+    tree_free_node(search, child_node);
 }
 
-void decision_tree_init(const int num_sockets, const int num_cores_per_socket,
-            const int num_processes)
+/* Skip placements equivalent to a previous sibling up to a relabelling of
+ * sockets or of processes. The skipped subtree only holds mirrors of
+ * candidates found earlier in depth-first order with the same norme and
+ * move_cost, so the returned candidate is unchanged */
+static int tree_is_symmetric(struct tree_search *search, const int socket_id)
 {
-    if (NULL != __sabo_tree_ctx)
-        return;
+    const struct tree_state *state = &(search->state);
+    const int idx = state->placed_num_processes;
+    const int num_free_cores = state->num_free_cores[socket_id];
+
+    if (!(__sabo_tree_ctx->flags & DECISION_TREE_FLAG_SYMMETRY))
+        return 0;
+
+    /* Identical processes are placed on non-decreasing sockets */
+    if (__sabo_tree_ctx->same_as_prev[idx] &&
+        socket_id < state->socket_ids[idx - 1]) {
+        search->stats.num_symmetric_cuts++;
+        return 1;
+    }
 
-    __sabo_tree_ctx = xzalloc(sizeof(struct tree_ctx));
+    /* Socket is the prev_socket_id of a remaining process, or the move
+     * costs tell sockets apart */
+    if (__sabo_tree_ctx->last_prev_idx[socket_id] >= idx ||
+        !__sabo_tree_ctx->uniform_costs)
+        return 0;
 
-    __sabo_tree_ctx->num_cores_per_socket = num_cores_per_socket;
-    __sabo_tree_ctx->num_sockets = num_sockets;
-    __sabo_tree_ctx->num_processes = num_processes;
+    /* Identical socket already explored */
+    for (int i = 0; i < socket_id; i++) {
+        if (num_free_cores != state->num_free_cores[i] ||
+            __sabo_tree_ctx->last_prev_idx[i] >= idx)
+            continue;
+
+        search->stats.num_symmetric_cuts++;
+        return 1;
+    }
 
-    tree_init_nodes_list(num_sockets, num_processes);
+    return 0;
+}
+
+/* Transposition table key: depth and socket free cores. The best norme and
+ * move cost reachable by the remaining processes do not depend on the
+ * labels of sockets that are not the prev_socket_id of a remaining process
+ * with uniform move costs: their free cores are sorted, others stay in
+ * place */
+static uint64_t tree_tt_key(struct tree_search *search, int **key)
+{
+    int *sorted;
+    int num_sorted = 0;
+    uint64_t hash;
+
+    const struct tree_state *state = &(search->state);
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int depth = state->placed_num_processes;
+    const int uniform_costs = __sabo_tree_ctx->uniform_costs;
+
+    /* Insertion sort, few sockets */
+    sorted = search->tt_sorted;
+    for (int i = 0; i < num_sockets; i++) {
+        const int num_free_cores = state->num_free_cores[i];
+        int j = num_sorted++;
+
+        if (!uniform_costs ||
+            __sabo_tree_ctx->last_prev_idx[i] >= depth) {
+            num_sorted--;
+            continue;
+        }
+
+        while (0 < j && sorted[j - 1] > num_free_cores) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = num_free_cores;
+    }
+
+    *key = &(search->tt_keys[depth * num_sockets]);
+
+    num_sorted = 0;
+    for (int i = 0; i < num_sockets; i++) {
+        if (!uniform_costs ||
+            __sabo_tree_ctx->last_prev_idx[i] >= depth)
+            (*key)[i] = state->num_free_cores[i];
+        else
+            (*key)[i] = sorted[num_sorted++];
+    }
+
+    hash = (uint64_t) depth * UINT64_C(0x9e3779b97f4a7c15);
+    for (int i = 0; i < num_sockets; i++) {
+        hash ^= (uint64_t) (uint32_t) (*key)[i];
+        hash *= UINT64_C(0xff51afd7ed558ccd);
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+static int *tree_tt_slot(struct tree_search *search, const uint64_t hash,
+             const int probe)
+{
+    const size_t stride = (size_t) (DECISION_TT_HEADER +
+                    __sabo_tree_ctx->num_sockets);
+    const size_t idx = (size_t) (hash + (uint64_t) probe) &
+               (DECISION_TT_NUM_SLOTS - 1);
+
+    return &(search->tt_slots[idx * stride]);
+}
+
+static int tree_tt_match(const int *slot, const int depth, const int *key)
+{
+    if (__sabo_tree_ctx->tt_generation != slot[DECISION_TT_GENERATION] ||
+        depth != slot[DECISION_TT_DEPTH])
+        return 0;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        if (key[i] != slot[DECISION_TT_HEADER + i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Bound of the norme and move cost added by the remaining processes,
+ * norme is INT_MAX if unknown and INT_MIN if there is no valid placement */
+static struct tree_bound tree_tt_lookup(struct tree_search *search,
+                    const uint64_t hash, const int *key)
+{
+    struct tree_bound bound = { INT_MAX, 0 };
+
+    const int depth = search->state.placed_num_processes;
+
+    for (int i = 0; i < DECISION_TT_NUM_PROBES; i++) {
+        const int *slot = tree_tt_slot(search, hash, i);
+
+        if (!tree_tt_match(slot, depth, key))
+            continue;
+
+        search->stats.num_tt_hits++;
+
+        bound.norme = slot[DECISION_TT_NORME];
+        bound.move_cost = slot[DECISION_TT_MOVE_COST];
+        return bound;
+    }
+
+    search->stats.num_tt_misses++;
+    return bound;
+}
+
+/* Keep the tightest bound of a state, otherwise use an empty slot or evict
+ * the deepest state which covers the smallest subtree */
+static void tree_tt_store(struct tree_search *search, const uint64_t hash,
+              const int *key, const struct tree_bound *bound)
+{
+    int *slot = NULL;
+
+    const int depth = search->state.placed_num_processes;
+    const int generation = __sabo_tree_ctx->tt_generation;
+
+    for (int i = 0; i < DECISION_TT_NUM_PROBES; i++) {
+        int *probe = tree_tt_slot(search, hash, i);
+
+        if (tree_tt_match(probe, depth, key)) {
+            const struct tree_bound prev = {
+                probe[DECISION_TT_NORME],
+                probe[DECISION_TT_MOVE_COST]
+            };
+
+            if (tree_bound_is_better(&prev, bound)) {
+                probe[DECISION_TT_NORME] = bound->norme;
+                probe[DECISION_TT_MOVE_COST] =
+                    bound->move_cost;
+            }
+            return;
+        }
+
+        if (NULL == slot || (generation == slot[DECISION_TT_GENERATION] &&
+                     (generation != probe[DECISION_TT_GENERATION] ||
+                      probe[DECISION_TT_DEPTH] > slot[DECISION_TT_DEPTH])))
+            slot = probe;
+    }
+
+    slot[DECISION_TT_GENERATION] = generation;
+    slot[DECISION_TT_DEPTH] = depth;
+    slot[DECISION_TT_NORME] = bound->norme;
+    slot[DECISION_TT_MOVE_COST] = bound->move_cost;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
+        slot[DECISION_TT_HEADER + i] = key[i];
+}
+
+/* Subtree can not hold a candidate better than the current one */
+static int tree_tt_cut(struct tree_search *search,
+               const struct tree_bound *bound)
+{
+    struct tree_bound max;
+    const struct tree_state *state = &(search->state);
+    const struct tree_candidate *best = &(search->best);
+
+    if (INT_MIN == bound->norme)
+        return 1;
+
+    max.norme = state->norme + bound->norme;
+    max.move_cost = state->move_cost +
+                 bound->move_cost;
+
+    if (tree_cut(max.norme))
+        return 1;
+
+    return (best->found && !tree_is_better(max.norme,
+                           max.move_cost,
+                           best)) ? 1 : 0;
+}
+
+/* Budget is counted in explored nodes rather than in time, so that every
+ * rank of the node stops at the same node and returns the same candidate */
+static int tree_is_out_of_budget(struct tree_search *search)
+{
+    const uint64_t budget = (uint64_t) __sabo_tree_ctx->budget;
+
+    if (0 == budget || !search->best.found || budget > search->stats.num_nodes)
+        return 0;
+
+    __sabo_tree_ctx->budget_exhausted = 1;
+    return 1;
+}
+
+/* First fit decreasing warm start: largest processes first, on their
+ * prev_socket_id while it has enough free cores, otherwise on the socket with
+ * the most free cores. The placement is replayed in tree order to get its
+ * norme and becomes the first candidate */
+static void tree_greedy_start(struct tree_search *search)
+{
+    struct tree_state *state = &(search->state);
+    struct tree_candidate *best = &(search->best);
+
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int num_processes = __sabo_tree_ctx->num_processes;
+
+    tree_reset_state(state);
+
+    for (int i = num_processes - 1; 0 <= i; i--) {
+        const struct tree_process *process = &(__sabo_tree_ctx->processes[i]);
+        int socket_id = process->prev_socket_id;
+
+        if (0 > socket_id || num_sockets <= socket_id ||
+            process->num_threads > state->num_free_cores[socket_id]) {
+            socket_id = 0;
+            for (int j = 1; j < num_sockets; j++) {
+                if (state->num_free_cores[j] >
+                    state->num_free_cores[socket_id])
+                    socket_id = j;
+            }
+        }
+
+        if (0 > state->num_free_cores[socket_id])
+            return; /* no valid socket left */
+
+        state->num_free_cores[socket_id] -= process->num_threads;
+        best->socket_ids[i] = socket_id;
+    }
+
+    tree_reset_state(state);
+
+    /* Smaller processes are placed first in the tree */
+    for (int i = 0; i < num_processes; i++) {
+        if (0 > state->num_free_cores[best->socket_ids[i]])
+            return;
+
+        tree_apply_state(state, best->socket_ids[i]);
+    }
+
+    best->norme = state->norme;
+    best->move_cost = state->move_cost;
+    best->found = 1;
+
+    search->stats.num_candidates++;
+    tree_update_min(best->norme);
+}
+
+static void tree_warm_start(struct tree_search *search)
+{
+    const struct tree_candidate *incumbent = &(__sabo_tree_ctx->incumbent);
+
+    tree_greedy_start(search);
+
+    if (!incumbent->found ||
+        !tree_is_better(incumbent->norme, incumbent->move_cost,
+                &(search->best)))
+        return;
+
+    tree_copy_candidate(&(search->best), incumbent);
+}
+
+static struct tree_bound tree_backtrack_recursive(struct tree_search *search);
+
+/* Explore a subtree through the transposition table. The stored bound is
+ * the best candidate found below the state, or the solver bounds if a branch
+ * has been cut. It is only valid for states whose subtree does not depend
+ * on previously placed processes: the norme is known and symmetry breaking
+ * does not constrain the next process placement */
+static struct tree_bound tree_backtrack_subtree(struct tree_search *search)
+{
+    int *key;
+    int min;
+    uint64_t hash;
+    uint64_t num_cuts;
+    struct tree_bound max;
+    struct tree_bound bound;
+
+    const struct tree_state *state = &(search->state);
+    const struct tree_candidate *best = &(search->best);
+    const struct tree_candidate *incumbent = &(__sabo_tree_ctx->incumbent);
+    const int idx = state->placed_num_processes;
+
+    if (!(__sabo_tree_ctx->flags & DECISION_TREE_FLAG_TRANSPOSITION) ||
+        INT_MIN == state->norme ||
+        __sabo_tree_ctx->num_processes - DECISION_TT_MIN_REMAINING < idx ||
+        ((__sabo_tree_ctx->flags & DECISION_TREE_FLAG_SYMMETRY) &&
+         __sabo_tree_ctx->same_as_prev[idx]))
+        return tree_backtrack_recursive(search);
+
+    hash = tree_tt_key(search, &key);
+
+    bound = tree_tt_lookup(search, hash, key);
+    if (INT_MAX != bound.norme && tree_tt_cut(search, &bound)) {
+        search->stats.num_cuts++;
+        bound.norme = INT_MIN;
+        return bound;
+    }
+
+    num_cuts = search->stats.num_cuts;
+    max = tree_backtrack_recursive(search);
+
+    /* Cut branches are worse than the shared bound or not better than the
+     * best candidate */
+    if (num_cuts != search->stats.num_cuts) {
+        min = __atomic_load_n(&(__sabo_tree_ctx->min), __ATOMIC_RELAXED);
+        if (INT_MIN != min) {
+            bound.norme = min - 1;
+            bound.move_cost = state->move_cost;
+            if (tree_bound_is_better(&bound, &max))
+                max = bound;
+        }
+
+        if (best->found) {
+            bound.norme = best->norme;
+            bound.move_cost = best->move_cost;
+            if (tree_bound_is_better(&bound, &max))
+                max = bound;
+        }
+
+        if (incumbent->found) {
+            bound.norme = incumbent->norme;
+            bound.move_cost = incumbent->move_cost;
+            if (tree_bound_is_better(&bound, &max))
+                max = bound;
+        }
+    }
+
+    bound = max;
+    if (INT_MIN != bound.norme) {
+        bound.norme -= state->norme;
+        bound.move_cost -= state->move_cost;
+    }
+
+    tree_tt_store(search, hash, key, &bound);
+
+    return max;
+}
+
+/* Copy-free depth first search: a single state is updated in place and
+ * restored from the undo log, the placement is only copied when a better
+ * candidate is found. Return the best norme and move cost found below
+ * the state */
+static struct tree_bound tree_backtrack_recursive(struct tree_search *search)
+{
+    struct tree_bound max = { INT_MIN, 0 };
+    struct tree_state *state = &(search->state);
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        if (0 > state->num_free_cores[i])
+            continue;
+
+        if (tree_is_out_of_budget(search))
+            break;
+
+        if (tree_is_symmetric(search, i))
+            continue;
+
+        /* Update information with process placement */
+        tree_apply_state(state, i);
+
+        search->stats.num_nodes++;
+
+        if (tree_bound_cut(search)) {
+            search->stats.num_cuts++;
+        } else if (__sabo_tree_ctx->num_processes !=
+               state->placed_num_processes) {
+            const struct tree_bound bound = tree_backtrack_subtree(search);
+
+            if (tree_bound_is_better(&bound, &max))
+                max = bound;
+        } else {
+            const struct tree_bound bound = {
+                state->norme, state->move_cost
+            };
+
+            if (tree_bound_is_better(&bound, &max))
+                max = bound;
+
+            if (tree_is_better(state->norme, state->move_cost,
+                       &(search->best))) {
+                struct tree_candidate *best = &(search->best);
+
+                /* Found a new candidate */
+                for (int j = 0; j < state->placed_num_processes; j++)
+                    best->socket_ids[j] = state->socket_ids[j];
+
+                best->norme = state->norme;
+                best->move_cost = state->move_cost;
+                best->found = 1;
+
+                search->stats.num_candidates++;
+                search->stats.num_copy_bytes += sizeof(int) *
+                    (size_t) state->placed_num_processes;
+
+                tree_update_min(state->norme);
+            }
+        }
+
+        tree_undo_state(state);
+    }
+
+    return max;
+}
+
+static uint64_t tree_dp_hash(const int *key)
+{
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets + 1; i++) {
+        hash ^= (uint64_t) (uint32_t) key[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+
+    return hash;
+}
+
+/* Exact solver key: the number of placed processes and the free cores of
+ * each socket. Oversubscribed sockets never receive a process anymore, so
+ * they share the same key */
+static uint64_t tree_dp_key(const struct tree_state *state, int **key)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    const int idx = state->placed_num_processes;
+
+    *key = &(__sabo_tree_ctx->dp_keys[idx * (num_sockets + 1)]);
+
+    (*key)[0] = idx;
+    for (int i = 0; i < num_sockets; i++)
+        (*key)[i + 1] = MAX(state->num_free_cores[i], -1);
+
+    return tree_dp_hash(*key);
+}
+
+static int *tree_dp_slot(const int idx)
+{
+    const size_t stride = (size_t) (DECISION_DP_HEADER + 1 +
+                    __sabo_tree_ctx->num_sockets);
+
+    return &(__sabo_tree_ctx->dp_slots[(size_t) idx * stride]);
+}
+
+/* Linear probing, slots of older placements are free */
+static int *tree_dp_find(const uint64_t hash, const int *key)
+{
+    const int mask = __sabo_tree_ctx->dp_num_slots - 1;
+    const size_t size = sizeof(int) *
+        (size_t) (1 + __sabo_tree_ctx->num_sockets);
+
+    for (int i = (int) (hash & (uint64_t) mask);; i = (i + 1) & mask) {
+        int *slot = tree_dp_slot(i);
+
+        if (__sabo_tree_ctx->dp_generation != slot[DECISION_DP_GENERATION] ||
+            0 == memcmp(&(slot[DECISION_DP_HEADER]), key, size))
+            return slot;
+    }
+}
+
+/* Double the slots and move the states of the current placement */
+static void tree_dp_grow(struct tree_search *search)
+{
+    int *slots = __sabo_tree_ctx->dp_slots;
+
+    const int num_slots = __sabo_tree_ctx->dp_num_slots;
+    const size_t stride = (size_t) (DECISION_DP_HEADER + 1 +
+                    __sabo_tree_ctx->num_sockets);
+
+    __sabo_tree_ctx->dp_num_slots = num_slots * 2;
+    __sabo_tree_ctx->dp_slots = xzalloc(sizeof(int) * stride *
+                        (size_t) num_slots * 2);
+    search->stats.num_allocs++;
+
+    for (int i = 0; i < num_slots; i++) {
+        const int *slot = &(slots[(size_t) i * stride]);
+        const int *key = &(slot[DECISION_DP_HEADER]);
+
+        if (__sabo_tree_ctx->dp_generation != slot[DECISION_DP_GENERATION])
+            continue;
+
+        memcpy(tree_dp_find(tree_dp_hash(key), key), slot,
+               sizeof(int) * stride);
+    }
+
+    xfree(slots);
+}
+
+static void tree_dp_store(struct tree_search *search, const uint64_t hash,
+              const int *key, const struct tree_bound *bound)
+{
+    int *slot;
+
+    if (__sabo_tree_ctx->dp_num_slots <= 2 * __sabo_tree_ctx->dp_num_states)
+        tree_dp_grow(search);
+
+    slot = tree_dp_find(hash, key);
+    assert(__sabo_tree_ctx->dp_generation != slot[DECISION_DP_GENERATION]);
+
+    slot[DECISION_DP_GENERATION] = __sabo_tree_ctx->dp_generation;
+    slot[DECISION_DP_NORME] = bound->norme;
+    slot[DECISION_DP_MOVE_COST] = bound->move_cost;
+    memcpy(&(slot[DECISION_DP_HEADER]), key,
+           sizeof(int) * (size_t) (1 + __sabo_tree_ctx->num_sockets));
+
+    __sabo_tree_ctx->dp_num_states++;
+}
+
+/* Invalidate exact solver states, they depend on processes */
+static void tree_next_dp_generation(void)
+{
+    const size_t size = sizeof(int) * (size_t) __sabo_tree_ctx->dp_num_slots *
+        (size_t) (DECISION_DP_HEADER + 1 + __sabo_tree_ctx->num_sockets);
+
+    __sabo_tree_ctx->dp_num_states = 0;
+
+    if (likely(INT_MAX > __sabo_tree_ctx->dp_generation)) {
+        __sabo_tree_ctx->dp_generation++;
+        return;
+    }
+
+    memset(__sabo_tree_ctx->dp_slots, 0, size);
+    __sabo_tree_ctx->dp_generation = 1;
+}
+
+static struct tree_bound tree_dp_value(struct tree_search *search);
+
+/* Best norme and move cost added by the remaining processes when the
+ * next one is placed on socket_id */
+static struct tree_bound tree_dp_child_value(struct tree_search *search,
+                         const int socket_id)
+{
+    struct tree_bound bound;
+    struct tree_state *state = &(search->state);
+
+    const int move_cost = state->move_cost;
+
+    tree_apply_state(state, socket_id);
+
+    bound = tree_dp_value(search);
+    if (INT_MAX != bound.move_cost) {
+        if (0 >= state->num_free_cores[socket_id])
+            bound.norme += state->num_free_cores[socket_id];
+
+        bound.move_cost += state->move_cost -
+            move_cost;
+    }
+
+    tree_undo_state(state);
+
+    return bound;
+}
+
+/* Best norme and move cost added by the remaining processes, the norme
+ * is INT_MIN while no socket is full and the move cost INT_MAX if the
+ * remaining processes can not be placed. The norme of a placement is only
+ * undefined when no socket is full: every socket with no free core has
+ * added its free cores to the norme, the state norme is defined as soon as
+ * one is full and the best remaining norme is relative to it */
+static struct tree_bound tree_dp_value(struct tree_search *search)
+{
+    int *key;
+    int *slot;
+    uint64_t hash;
+    struct tree_bound max = { INT_MIN, INT_MAX };
+
+    const struct tree_state *state = &(search->state);
+
+    if (__sabo_tree_ctx->num_processes == state->placed_num_processes) {
+        max.norme = (INT_MIN == state->norme) ? INT_MIN : 0;
+        max.move_cost = 0;
+        return max;
+    }
+
+    hash = tree_dp_key(state, &key);
+
+    slot = tree_dp_find(hash, key);
+    if (__sabo_tree_ctx->dp_generation == slot[DECISION_DP_GENERATION]) {
+        search->stats.num_tt_hits++;
+        max.norme = slot[DECISION_DP_NORME];
+        max.move_cost = slot[DECISION_DP_MOVE_COST];
+        return max;
+    }
+
+    search->stats.num_tt_misses++;
+    search->stats.num_nodes++;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        struct tree_bound bound;
+
+        if (0 > state->num_free_cores[i])
+            continue;
+
+        bound = tree_dp_child_value(search, i);
+        if (tree_bound_is_better(&bound, &max))
+            max = bound;
+    }
+
+    tree_dp_store(search, hash, key, &max);
+
+    return max;
+}
+
+/* Exact dynamic programming solver over the free cores of the sockets. The
+ * placement is rebuilt from the root with the first socket reaching the
+ * best value of each state, which is the first best candidate of the tree
+ * in depth-first order */
+static void tree_dp_solve(struct tree_search *search)
+{
+    struct tree_bound max;
+    struct tree_state *state = &(search->state);
+    struct tree_candidate *best = &(search->best);
+
+    tree_next_dp_generation();
+    tree_reset_state(state);
+
+    max = tree_dp_value(search);
+    if (INT_MAX == max.move_cost)
+        return;
+
+    while (__sabo_tree_ctx->num_processes != state->placed_num_processes) {
+        for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+            struct tree_bound bound;
+
+            if (0 > state->num_free_cores[i])
+                continue;
+
+            bound = tree_dp_child_value(search, i);
+            if (bound.norme != max.norme ||
+                bound.move_cost != max.move_cost)
+                continue;
+
+            tree_apply_state(state, i);
+            max = tree_dp_value(search);
+            break;
+        }
+    }
+
+    for (int i = 0; i < state->placed_num_processes; i++)
+        best->socket_ids[i] = state->socket_ids[i];
+
+    best->norme = state->norme;
+    best->move_cost = state->move_cost;
+    best->found = 1;
+
+    search->stats.num_candidates++;
+}
+
+/* Search the best candidate below the placement of the first depth
+ * processes given by prefix */
+static void tree_solve(struct tree_search *search, const int *prefix,
+               const int depth)
+{
+    struct tree_node *root;
+    struct tree_node *best;
+
+    search->best.found = 0;
+
+    if (DECISION_TREE_SOLVER_DP == __sabo_tree_ctx->solver) {
+        assert(0 == depth);
+        tree_dp_solve(search);
+        return;
+    }
+
+    if (DECISION_TREE_SOLVER_BACKTRACK == __sabo_tree_ctx->solver) {
+        if (0 < __sabo_tree_ctx->budget)
+            tree_warm_start(search);
+
+        tree_reset_state(&(search->state));
+        for (int i = 0; i < depth; i++)
+            tree_apply_state(&(search->state), prefix[i]);
+
+        (void) tree_backtrack_recursive(search);
+        return;
+    }
+
+    root = tree_alloc_root_node(search);
+    for (int i = 0; i < depth; i++)
+        tree_update_node(root, prefix[i]);
+    root->depth = depth;
+
+    search->best_node = NULL;
+    tree_build_tree_recursive(search, root);
+    tree_free_node(search, root);
+
+    if (NULL == (best = search->best_node))
+        return;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++)
+        search->best.socket_ids[i] = best->processes[i].socket_id;
+
+    search->best.norme = best->norme;
+    search->best.move_cost = best->move_cost;
+    search->best.found = 1;
+
+    tree_free_node(search, best);
+    search->best_node = NULL;
+}
+
+/* Enumerate tree nodes at depth to build parallel solver subproblems */
+static void tree_split_recursive(struct tree_search *search, const int depth)
+{
+    struct tree_state *state = &(search->state);
+
+    if (depth == state->placed_num_processes) {
+        const int idx = __sabo_tree_ctx->num_tasks++;
+
+        if (DECISION_MAX_TASKS <= idx)
+            return;
+
+        for (int i = 0; i < depth; i++)
+            __sabo_tree_ctx->tasks[idx].prefix[i] = state->socket_ids[i];
+
+        return;
+    }
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        if (DECISION_MAX_TASKS < __sabo_tree_ctx->num_tasks)
+            break;
+
+        if (0 > state->num_free_cores[i])
+            continue;
+
+        /* Only the backtracking solver breaks symmetries */
+        if (DECISION_TREE_SOLVER_BACKTRACK == __sabo_tree_ctx->solver &&
+            tree_is_symmetric(search, i))
+            continue;
+
+        tree_apply_state(state, i);
+        tree_split_recursive(search, depth);
+        tree_undo_state(state);
+    }
+}
+
+/* Split top levels of the tree, keep the smallest depth giving enough
+ * subproblems to feed every solver threads */
+static int tree_split_tasks(void)
+{
+    int depth = 0;
+    struct tree_search *search = &(__sabo_tree_ctx->searches[0]);
+
+    const int target = __sabo_tree_ctx->num_threads *
+               DECISION_TASKS_PER_THREAD;
+
+    tree_reset_state(&(search->state));
+
+    for (int i = 1; i < __sabo_tree_ctx->num_processes; i++) {
+        __sabo_tree_ctx->num_tasks = 0;
+        tree_split_recursive(search, i);
+
+        if (DECISION_MAX_TASKS < __sabo_tree_ctx->num_tasks)
+            break;
+
+        depth = i;
+        if (target <= __sabo_tree_ctx->num_tasks)
+            break;
+    }
+
+    /* Subproblems overwritten by a too deep split */
+    if (DECISION_MAX_TASKS < __sabo_tree_ctx->num_tasks) {
+        __sabo_tree_ctx->num_tasks = 0;
+        if (0 < depth)
+            tree_split_recursive(search, depth);
+    }
+
+    __sabo_tree_ctx->tasks_depth = depth;
+
+    return depth;
+}
+
+static void tree_solve_task(struct tree_search *search, struct tree_task *task)
+{
+    const double start = sabo_omp_get_wtime();
+
+    tree_solve(search, task->prefix, __sabo_tree_ctx->tasks_depth);
+    tree_copy_candidate(&(task->best), &(search->best));
+
+    search->elapsed += sabo_omp_get_wtime() - start;
+}
+
+/* Reduce subproblems in tree order to keep the serial solver candidate */
+static struct tree_candidate *tree_solve_parallel(void)
+{
+    struct tree_candidate *best = NULL;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_threads; i++)
+        __sabo_tree_ctx->searches[i].elapsed = (double) 0;
+
+    #pragma omp parallel for schedule(dynamic, 1) \
+        num_threads(__sabo_tree_ctx->num_threads)
+    for (int i = 0; i < __sabo_tree_ctx->num_tasks; i++) {
+        const int tid = omp_get_thread_num();
+        tree_solve_task(&(__sabo_tree_ctx->searches[tid]),
+                &(__sabo_tree_ctx->tasks[i]));
+    }
+
+    for (int i = 0; i < __sabo_tree_ctx->num_tasks; i++) {
+        struct tree_candidate *candidate = &(__sabo_tree_ctx->tasks[i].best);
+
+        if (!candidate->found)
+            continue;
+
+        if (best && !tree_is_better(candidate->norme,
+                        candidate->move_cost, best))
+            continue;
+
+        best = candidate;
+    }
+
+    return best;
+}
+
+static void tree_update_core_processes_list(const struct tree_candidate *best)
+{
+    /* Swap prev_socket_id with socket id for core processes */
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        struct tree_process *tree_process = &(__sabo_tree_ctx->processes[i]);
+        const int socket_id = tree_process->core_process->socket_id;
+
+        assert(best->socket_ids[i] >= 0);
+        tree_process->socket_id = best->socket_ids[i];
+        tree_process->core_process->socket_id = best->socket_ids[i];
+        tree_process->core_process->prev_socket_id = socket_id;
+    }
+}
+
+/* Invalidate transposition table slots, they depend on processes */
+static void tree_next_tt_generation(void)
+{
+    const size_t size = sizeof(int) * DECISION_TT_NUM_SLOTS *
+        (size_t) (DECISION_TT_HEADER + __sabo_tree_ctx->num_sockets);
+
+    if (likely(INT_MAX > __sabo_tree_ctx->tt_generation)) {
+        __sabo_tree_ctx->tt_generation++;
+        return;
+    }
+
+    for (int i = 0; i < __sabo_tree_ctx->num_threads; i++)
+        memset(__sabo_tree_ctx->searches[i].tt_slots, 0, size);
+
+    __sabo_tree_ctx->tt_generation = 1;
+}
+
+/* Placements depend on the solver configuration */
+static void tree_invalidate_placements(void)
+{
+    __sabo_tree_ctx->last_valid = 0;
+
+    for (int i = 0; i < __sabo_tree_ctx->cache_size; i++)
+        __sabo_tree_ctx->cache_stamps[i] = 0;
+}
+
+/* Same requested num threads than the previous call */
+static int tree_is_last_input(const struct core_process *processes)
+{
+    if (!tree_is_incremental())
+        return 0;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        if (__sabo_tree_ctx->last_num_threads[i] != processes[i].num_threads)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Same update than tree_update_core_processes_list from a placement
+ * indexed like the core processes */
+static void tree_apply_placement(struct core_process *processes,
+                 const int *socket_ids)
+{
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        const int socket_id = processes[i].socket_id;
+
+        processes[i].socket_id = socket_ids[i];
+        processes[i].prev_socket_id = socket_id;
+    }
+}
+
+static void tree_save_last_placement(const struct core_process *processes,
+                     const int *socket_ids, const int exact)
+{
+    if (!(__sabo_tree_ctx->flags & DECISION_TREE_FLAG_INCREMENTAL))
+        return;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        __sabo_tree_ctx->last_num_threads[i] = processes[i].num_threads;
+        __sabo_tree_ctx->last_socket_ids[i] = socket_ids[i];
+    }
+
+    __sabo_tree_ctx->last_valid = 1;
+    __sabo_tree_ctx->last_exact = exact;
+}
+
+/* Number of keys of the current processes */
+static int tree_cache_num_keys(void)
+{
+    return DECISION_CACHE_HEADER +
+        __sabo_tree_ctx->num_processes * DECISION_CACHE_NUM_KEYS;
+}
+
+/* Cache key: number of processes, requested num threads and move cost
+ * baseline of each process, the solver is deterministic for a given key.
+ * Entries of another number of processes never match */
+static uint64_t tree_cache_key(const struct core_process *processes)
+{
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    int *key = __sabo_tree_ctx->cache_key;
+
+    const int incremental = tree_is_incremental();
+
+    key[0] = __sabo_tree_ctx->num_processes;
+    key += DECISION_CACHE_HEADER;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        key[i * DECISION_CACHE_NUM_KEYS] = processes[i].num_threads;
+        key[i * DECISION_CACHE_NUM_KEYS + 1] = (incremental) ?
+            __sabo_tree_ctx->last_socket_ids[i] :
+            processes[i].prev_socket_id;
+    }
+
+    key = __sabo_tree_ctx->cache_key;
+    for (int i = 0; i < tree_cache_num_keys(); i++) {
+        hash ^= (uint64_t) (uint32_t) key[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+
+    return hash;
+}
+
+static int *tree_cache_entry(const int idx)
+{
+    const size_t stride = DECISION_CACHE_HEADER +
+        (size_t) __sabo_tree_ctx->max_processes *
+        (DECISION_CACHE_NUM_KEYS + 1);
+
+    return &(__sabo_tree_ctx->cache_entries[(size_t) idx * stride]);
+}
+
+/* Return the cached placement of the key, NULL on miss */
+static const int *tree_cache_lookup(const uint64_t hash)
+{
+    const int num_keys = tree_cache_num_keys();
+    const size_t size = sizeof(int) * (size_t) num_keys;
+
+    __sabo_tree_ctx->cache_lookups++;
+
+    for (int i = 0; i < __sabo_tree_ctx->cache_size; i++) {
+        const int *entry;
+
+        if (0 == __sabo_tree_ctx->cache_stamps[i] ||
+            hash != __sabo_tree_ctx->cache_hashes[i])
+            continue;
+
+        entry = tree_cache_entry(i);
+        if (0 != memcmp(entry, __sabo_tree_ctx->cache_key, size))
+            continue;
+
+        __sabo_tree_ctx->cache_hits++;
+        __sabo_tree_ctx->cache_stamps[i] = ++__sabo_tree_ctx->cache_clock;
+
+        return entry + num_keys;
+    }
+
+    return NULL;
+}
+
+/* Store the placement in an empty entry or in the least recently used one */
+static void tree_cache_store(const uint64_t hash, const int *socket_ids)
+{
+    int *entry;
+    int idx = 0;
+
+    const int num_keys = tree_cache_num_keys();
+
+    for (int i = 1; i < __sabo_tree_ctx->cache_size; i++) {
+        if (__sabo_tree_ctx->cache_stamps[i] <
+            __sabo_tree_ctx->cache_stamps[idx])
+            idx = i;
+    }
+
+    entry = tree_cache_entry(idx);
+
+    memcpy(entry, __sabo_tree_ctx->cache_key, sizeof(int) * (size_t) num_keys);
+    memcpy(entry + num_keys, socket_ids,
+           sizeof(int) * (size_t) __sabo_tree_ctx->num_processes);
+
+    __sabo_tree_ctx->cache_hashes[idx] = hash;
+    __sabo_tree_ctx->cache_stamps[idx] = ++__sabo_tree_ctx->cache_clock;
+}
+
+/* Replay the previous placement on the new num threads. It is a valid
+ * placement of the tree without socket change, so the best candidate is at
+ * least as good: its norme is a bound from the first node and subtrees with
+ * a move cost at equal norme are cut */
+static void tree_init_incumbent(const struct core_process *processes)
+{
+    struct tree_candidate *incumbent = &(__sabo_tree_ctx->incumbent);
+    struct tree_state *state = &(__sabo_tree_ctx->searches[0].state);
+
+    incumbent->found = 0;
+
+    if (!tree_is_incremental())
+        return;
+
+    tree_reset_state(state);
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        const struct tree_process *process = &(__sabo_tree_ctx->processes[i]);
+        const int idx = (int) (process->core_process - processes);
+        const int socket_id = __sabo_tree_ctx->last_socket_ids[idx];
+
+        if (0 > state->num_free_cores[socket_id])
+            return;
+
+        tree_apply_state(state, socket_id);
+        incumbent->socket_ids[i] = socket_id;
+    }
+
+    incumbent->norme = state->norme;
+    incumbent->move_cost = state->move_cost;
+    incumbent->found = 1;
+
+    tree_update_min(incumbent->norme);
+}
+
+void decision_tree_compute_placement(struct core_process *processes)
+{
+    uint64_t hash = 0;
+    struct tree_candidate *best;
+    struct tree_search *search = &(__sabo_tree_ctx->searches[0]);
+
+#ifndef NDEBUG
+    double elapsed;
+    const double start = sabo_omp_get_wtime();
+#endif /* #ifndef NDEBUG */
+
+    for (int i = 0; i < __sabo_tree_ctx->num_threads; i++) {
+        struct decision_tree_stats *stats;
+        stats = &(__sabo_tree_ctx->searches[i].stats);
+        memset(stats, 0, sizeof(struct decision_tree_stats));
+    }
+
+    __sabo_tree_ctx->num_tasks = 0;
+    __sabo_tree_ctx->budget_exhausted = 0;
+
+    /* An exact previous placement has the best norme for these num threads
+     * and no socket change from itself, it is the only best candidate. A
+     * placement stopped by the budget is searched again */
+    if (__sabo_tree_ctx->last_exact && tree_is_last_input(processes)) {
+        tree_apply_placement(processes, __sabo_tree_ctx->last_socket_ids);
+        search->stats.num_reuses++;
+
+#ifndef NDEBUG
+        debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s) (previous "
+              "placement)", __func__,
+              (sabo_omp_get_wtime() - start) * 1000000);
+#endif /* #ifndef NDEBUG */
+        return;
+    }
+
+    if (0 < __sabo_tree_ctx->cache_size) {
+        const int *socket_ids;
+
+        hash = tree_cache_key(processes);
+
+        if (NULL != (socket_ids = tree_cache_lookup(hash))) {
+            tree_save_last_placement(processes, socket_ids, 1);
+            tree_apply_placement(processes, socket_ids);
+            search->stats.num_cache_hits++;
+
+#ifndef NDEBUG
+            debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s) (cached "
+                  "placement, hit rate %.1f%%)", __func__,
+                  (sabo_omp_get_wtime() - start) * 1000000,
+                  (double) __sabo_tree_ctx->cache_hits * 100 /
+                  (double) __sabo_tree_ctx->cache_lookups);
+#endif /* #ifndef NDEBUG */
+            return;
+        }
+    }
+
+    /* Initialize sorted processes */
+    tree_init_processes(processes);
+
+    __sabo_tree_ctx->min = INT_MIN;
+
+    tree_init_incumbent(processes);
+    tree_next_tt_generation();
+
+    /* Find best candidate, a budget needs the serial exploration order and
+     * the exact solver is serial */
+    if (1 < __sabo_tree_ctx->num_threads && 0 == __sabo_tree_ctx->budget &&
+        DECISION_TREE_SOLVER_DP != __sabo_tree_ctx->solver &&
+        0 < tree_split_tasks()) {
+        best = tree_solve_parallel();
+    } else {
+        tree_solve(search, NULL, 0);
+        best = (search->best.found) ? &(search->best) : NULL;
+    }
+
+    if (unlikely(NULL == best)) {
+        error("num_socket: %d", __sabo_tree_ctx->num_sockets);
+        for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++)
+            error("socket #%d num_cores: %d", i, __sabo_tree_ctx->num_cores[i]);
+        error("num_processes: %d", __sabo_tree_ctx->num_processes);
+        for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+            error("process #%d num_threads: %d",
+                  processes[i].node_rank, processes[i].num_threads);
+        }
+        fatal_error("Failed to compute solution");
+    }
+
+#ifndef NDEBUG
+    tree_dump_placement(best);
+#endif /* #ifndef NDEBUG */
+
+    for (int i = 0; i < __sabo_tree_ctx->num_processes; i++) {
+        const struct tree_process *process = &(__sabo_tree_ctx->processes[i]);
+        const int idx = (int) (process->core_process - processes);
+
+        __sabo_tree_ctx->placement[idx] = best->socket_ids[i];
+    }
+
+    tree_save_last_placement(processes, __sabo_tree_ctx->placement,
+                 !__sabo_tree_ctx->budget_exhausted);
+
+    /* Only exact placements are cached */
+    if (0 < __sabo_tree_ctx->cache_size && !__sabo_tree_ctx->budget_exhausted)
+        tree_cache_store(hash, __sabo_tree_ctx->placement);
+
+    /* Store compute processes list */
+    tree_update_core_processes_list(best);
+
+#ifndef NDEBUG
+    elapsed = sabo_omp_get_wtime() - start;
+
+    if (__sabo_tree_ctx->budget_exhausted) {
+        debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s) (%s solver) "
+              "stopped after a budget of %d node(s)",
+              __func__, elapsed * 1000000,
+              tree_solver_names[__sabo_tree_ctx->solver],
+              __sabo_tree_ctx->budget);
+    } else if (0 == __sabo_tree_ctx->num_tasks) {
+        debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s) (%s solver)",
+              __func__, elapsed * 1000000,
+              tree_solver_names[__sabo_tree_ctx->solver]);
+    } else {
+        double cumulate = (double) 0;
+
+        for (int i = 0; i < __sabo_tree_ctx->num_threads; i++)
+            cumulate += __sabo_tree_ctx->searches[i].elapsed;
+
+        debug(LOG_DEBUG_PERF, "Compute %s in %.3f usec(s) (%s solver) "
+              "with %d thread(s) on %d task(s) depth %d (speedup %.2f)",
+              __func__, elapsed * 1000000,
+              tree_solver_names[__sabo_tree_ctx->solver],
+              __sabo_tree_ctx->num_threads, __sabo_tree_ctx->num_tasks,
+              __sabo_tree_ctx->tasks_depth, cumulate / elapsed);
+    }
+
+    if (0 < __sabo_tree_ctx->cache_lookups) {
+        debug(LOG_DEBUG_PERF, "Placement cache hit rate %.1f%% "
+              "(%" PRIu64 " hit(s) on %" PRIu64 " lookup(s))",
+              (double) __sabo_tree_ctx->cache_hits * 100 /
+              (double) __sabo_tree_ctx->cache_lookups,
+              __sabo_tree_ctx->cache_hits, __sabo_tree_ctx->cache_lookups);
+    }
+#endif /* #ifndef NDEBUG */
+}
+
+void decision_tree_get_stats(struct decision_tree_stats *stats)
+{
+    memset(stats, 0, sizeof(struct decision_tree_stats));
+
+    for (int i = 0; i < __sabo_tree_ctx->num_threads; i++) {
+        const struct decision_tree_stats *search_stats;
+
+        search_stats = &(__sabo_tree_ctx->searches[i].stats);
+
+        stats->num_nodes += search_stats->num_nodes;
+        stats->num_candidates += search_stats->num_candidates;
+        stats->num_copy_bytes += search_stats->num_copy_bytes;
+        stats->num_allocs += search_stats->num_allocs;
+        stats->num_symmetric_cuts += search_stats->num_symmetric_cuts;
+        stats->num_cuts += search_stats->num_cuts;
+        stats->num_bound_cuts += search_stats->num_bound_cuts;
+        stats->num_tt_hits += search_stats->num_tt_hits;
+        stats->num_tt_misses += search_stats->num_tt_misses;
+        stats->num_reuses += search_stats->num_reuses;
+        stats->num_cache_hits += search_stats->num_cache_hits;
+    }
+}
+
+static void tree_fini_parallel(void)
+{
+    if (NULL != __sabo_tree_ctx->searches) {
+        for (int i = 0; i < __sabo_tree_ctx->num_threads; i++)
+            tree_fini_search(&(__sabo_tree_ctx->searches[i]));
+        xfree(__sabo_tree_ctx->searches);
+        __sabo_tree_ctx->searches = NULL;
+    }
+
+    if (NULL != __sabo_tree_ctx->tasks) {
+        for (int i = 0; i < DECISION_MAX_TASKS; i++) {
+            xfree(__sabo_tree_ctx->tasks[i].prefix);
+            tree_fini_candidate(&(__sabo_tree_ctx->tasks[i].best));
+        }
+        xfree(__sabo_tree_ctx->tasks);
+        __sabo_tree_ctx->tasks = NULL;
+    }
+}
+
+/* The exact solver states are bounded by the free cores of every socket but
+ * the last one, given by the placed threads until a socket is full */
+static enum decision_tree_solver tree_select_solver(void)
+{
+    double num_states = (double) __sabo_tree_ctx->num_processes;
+
+    if (DECISION_DP_MAX_SOCKETS < __sabo_tree_ctx->num_sockets)
+        return DECISION_TREE_SOLVER_BACKTRACK;
+
+    for (int i = 1; i < __sabo_tree_ctx->num_sockets; i++)
+        num_states *= (double) (__sabo_tree_ctx->num_cores[i] + 2);
+
+    return ((double) DECISION_DP_MAX_STATES >= num_states) ?
+        DECISION_TREE_SOLVER_DP : DECISION_TREE_SOLVER_BACKTRACK;
+}
+
+/* Only the backtracking solver stops on a budget, a budgeted run of the
+ * other solvers is redirected to it */
+static void tree_resolve_solver(void)
+{
+    const enum decision_tree_solver requested =
+        (enum decision_tree_solver) __sabo_tree_ctx->requested_solver;
+    enum decision_tree_solver solver = requested;
+
+    if (0 < __sabo_tree_ctx->budget) {
+        if (DECISION_TREE_SOLVER_AUTO != requested &&
+            DECISION_TREE_SOLVER_BACKTRACK != requested)
+            error("The %s solver has no budget, a budget of %d node(s) "
+                  "runs the %s solver", tree_solver_names[requested],
+                  __sabo_tree_ctx->budget,
+                  tree_solver_names[DECISION_TREE_SOLVER_BACKTRACK]);
+
+        solver = DECISION_TREE_SOLVER_BACKTRACK;
+    } else if (DECISION_TREE_SOLVER_AUTO == requested) {
+        solver = tree_select_solver();
+    }
+
+    __sabo_tree_ctx->solver = (int) solver;
+}
+
+void decision_tree_set_num_threads(const int num_threads)
+{
+    void *ptr;
+    const int num_processes = __sabo_tree_ctx->max_processes;
+
+    if (unlikely(1 > num_threads))
+        fatal_error("Invalid solver num threads (%d)", num_threads);
+
+    tree_fini_parallel();
+
+    __sabo_tree_ctx->num_threads = num_threads;
+    tree_invalidate_placements();
+
+    ptr = xzalloc(sizeof(struct tree_search) * (size_t) num_threads);
+    __sabo_tree_ctx->searches = (struct tree_search *) ptr;
+
+    for (int i = 0; i < num_threads; i++)
+        tree_init_search(&(__sabo_tree_ctx->searches[i]), (0 == i));
+
+    if (1 == num_threads)
+        return;
+
+    ptr = xzalloc(sizeof(struct tree_task) * DECISION_MAX_TASKS);
+    __sabo_tree_ctx->tasks = (struct tree_task *) ptr;
+
+    for (int i = 0; i < DECISION_MAX_TASKS; i++) {
+        struct tree_task *task = &(__sabo_tree_ctx->tasks[i]);
+        task->prefix = xzalloc(sizeof(int) * (size_t) num_processes);
+        tree_init_candidate(&(task->best), num_processes);
+    }
+}
+
+/* Explored nodes before the best candidate found is returned, 0 for an
+ * exhaustive search. A budget runs the backtracking solver and disables the
+ * parallel mode, the budget needs the serial exploration order */
+void decision_tree_set_budget(const int num_nodes)
+{
+    if (unlikely(0 > num_nodes))
+        fatal_error("Invalid solver budget (%d)", num_nodes);
+
+    __sabo_tree_ctx->budget = num_nodes;
+    tree_resolve_solver();
+    tree_invalidate_placements();
+}
+
+static void tree_fini_cache(void)
+{
+    xfree(__sabo_tree_ctx->cache_key);
+    xfree(__sabo_tree_ctx->cache_entries);
+    xfree(__sabo_tree_ctx->cache_hashes);
+    xfree(__sabo_tree_ctx->cache_stamps);
+
+    __sabo_tree_ctx->cache_key = NULL;
+    __sabo_tree_ctx->cache_entries = NULL;
+    __sabo_tree_ctx->cache_hashes = NULL;
+    __sabo_tree_ctx->cache_stamps = NULL;
+    __sabo_tree_ctx->cache_size = 0;
+}
+
+void decision_tree_set_cache_size(const int num_entries)
+{
+    void *ptr;
+    const size_t num_keys = DECISION_CACHE_HEADER +
+        (size_t) __sabo_tree_ctx->max_processes * DECISION_CACHE_NUM_KEYS;
+
+    if (unlikely(0 > num_entries))
+        fatal_error("Invalid solver cache size (%d)", num_entries);
+
+    tree_fini_cache();
+    tree_invalidate_placements();
+
+    __sabo_tree_ctx->cache_lookups = 0;
+    __sabo_tree_ctx->cache_hits = 0;
+
+    if (0 == num_entries)
+        return;
+
+    __sabo_tree_ctx->cache_size = num_entries;
+
+    ptr = xzalloc(sizeof(int) * num_keys);
+    __sabo_tree_ctx->cache_key = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_entries *
+              (num_keys + (size_t) __sabo_tree_ctx->max_processes));
+    __sabo_tree_ctx->cache_entries = (int *) ptr;
+
+    ptr = xzalloc(sizeof(uint64_t) * (size_t) num_entries);
+    __sabo_tree_ctx->cache_hashes = (uint64_t *) ptr;
+
+    ptr = xzalloc(sizeof(uint64_t) * (size_t) num_entries);
+    __sabo_tree_ctx->cache_stamps = (uint64_t *) ptr;
+}
+
+/* Sockets with unequal core counts, e.g. when the resource manager hides
+ * some cores of a socket */
+void decision_tree_set_socket_num_cores(const int *num_cores)
+{
+    int total_num_cores = 0;
+
+    for (int i = 0; i < __sabo_tree_ctx->num_sockets; i++) {
+        if (unlikely(0 > num_cores[i] ||
+                 __sabo_tree_ctx->num_cores_per_socket < num_cores[i]))
+            fatal_error("Invalid num cores on socket #%d (%d)", i,
+                    num_cores[i]);
+
+        __sabo_tree_ctx->num_cores[i] = num_cores[i];
+        total_num_cores += num_cores[i];
+    }
+
+    __sabo_tree_ctx->total_num_cores = total_num_cores;
+    tree_resolve_solver();
+    tree_invalidate_placements();
+}
+
+/* Weighted socket changes, e.g. the memory distance between sockets. NULL
+ * costs count every socket change once */
+void decision_tree_set_socket_move_costs(const int *costs)
+{
+    const int num_sockets = __sabo_tree_ctx->num_sockets;
+    int no_prev_cost = INT_MAX;
+    int uniform_costs = 1;
+
+    for (int i = 0; i < num_sockets; i++) {
+        int min_move_cost = INT_MAX;
+
+        for (int j = 0; j < num_sockets; j++) {
+            const int idx = i * num_sockets + j;
+            const int cost = (i == j) ? 0 : (NULL == costs) ? 1 : costs[idx];
+
+            if (unlikely(0 > cost))
+                fatal_error("Invalid move cost from socket #%d to socket "
+                        "#%d (%d)", i, j, cost);
+
+            __sabo_tree_ctx->move_costs[idx] = cost;
+            if (i == j)
+                continue;
+
+            if (INT_MAX != no_prev_cost && cost != no_prev_cost)
+                uniform_costs = 0;
+
+            min_move_cost = MIN(min_move_cost, cost);
+            no_prev_cost = MIN(no_prev_cost, cost);
+        }
+
+        __sabo_tree_ctx->min_move_costs[i] =
+            (INT_MAX == min_move_cost) ? 0 : min_move_cost;
+    }
+
+    __sabo_tree_ctx->no_prev_cost =
+        (INT_MAX == no_prev_cost) ? 1 : no_prev_cost;
+    __sabo_tree_ctx->uniform_costs = uniform_costs;
+    tree_invalidate_placements();
+}
+
+void decision_tree_set_flags(const int flags)
+{
+    __sabo_tree_ctx->flags = flags;
+    tree_invalidate_placements();
+}
+
+/* Place fewer processes than the tree was initialized for. The solver
+ * threads, the transposition tables and the cached placements are kept,
+ * only the previous placement of another number of processes is dropped */
+void decision_tree_set_num_processes(const int num_processes)
+{
+    if (unlikely(1 > num_processes ||
+             __sabo_tree_ctx->max_processes < num_processes))
+        fatal_error("Invalid solver num processes (%d)", num_processes);
+
+    if (num_processes == __sabo_tree_ctx->num_processes)
+        return;
+
+    __sabo_tree_ctx->num_processes = num_processes;
+    __sabo_tree_ctx->last_valid = 0;
+    __sabo_tree_ctx->last_exact = 0;
+    tree_resolve_solver();
+}
+
+void decision_tree_set_solver(const enum decision_tree_solver solver)
+{
+    if (unlikely(0 > (int) solver || DECISION_TREE_NUM_SOLVERS <= solver))
+        fatal_error("Invalid solver (%d)", (int) solver);
+
+    __sabo_tree_ctx->requested_solver = (int) solver;
+    tree_resolve_solver();
+    tree_invalidate_placements();
+}
+
+enum decision_tree_solver decision_tree_get_solver(void)
+{
+    return (enum decision_tree_solver) __sabo_tree_ctx->requested_solver;
+}
+
+/* Solver actually run, never DECISION_TREE_SOLVER_AUTO */
+enum decision_tree_solver decision_tree_get_active_solver(void)
+{
+    return (enum decision_tree_solver) __sabo_tree_ctx->solver;
+}
+
+const char *decision_tree_get_solver_name(const enum decision_tree_solver solver)
+{
+    return tree_solver_names[solver];
+}
+
+static enum decision_tree_solver tree_get_env_solver(void)
+{
+    char string[64];
+
+    env_get_solver(string, sizeof(string));
+
+    if ('\0' == string[0])
+        return DECISION_TREE_SOLVER_AUTO;
+
+    for (int i = 0; i < DECISION_TREE_NUM_SOLVERS; i++) {
+        if (0 == strcmp(string, tree_solver_names[i]))
+            return (enum decision_tree_solver) i;
+    }
+
+    error("Unknown solver '%s'", string);
+    return DECISION_TREE_SOLVER_AUTO;
+}
+
+void decision_tree_init(const int num_sockets, const int num_cores_per_socket,
+            const int num_processes)
+{
+    int flags;
+    void *ptr;
+
+    if (NULL != __sabo_tree_ctx)
+        return;
+
+    __sabo_tree_ctx = xzalloc(sizeof(struct tree_ctx));
+
+    __sabo_tree_ctx->num_cores_per_socket = num_cores_per_socket;
+    __sabo_tree_ctx->num_sockets = num_sockets;
+    __sabo_tree_ctx->num_processes = num_processes;
+    __sabo_tree_ctx->max_processes = num_processes;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_sockets);
+    __sabo_tree_ctx->num_cores = (int *) ptr;
+
+    for (int i = 0; i < num_sockets; i++)
+        __sabo_tree_ctx->num_cores[i] = num_cores_per_socket;
+    __sabo_tree_ctx->total_num_cores = num_sockets * num_cores_per_socket;
+
+    ptr = xzalloc(sizeof(int) * (size_t) (num_sockets * num_sockets));
+    __sabo_tree_ctx->move_costs = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_sockets);
+    __sabo_tree_ctx->min_move_costs = (int *) ptr;
+
+    ptr = xzalloc(sizeof(struct tree_process) * (size_t) num_processes);
+    __sabo_tree_ctx->processes = (struct tree_process *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_processes);
+    __sabo_tree_ctx->same_as_prev = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_sockets);
+    __sabo_tree_ctx->last_prev_idx = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) (num_processes + 1));
+    __sabo_tree_ctx->remaining_threads = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) (num_processes + 1));
+    __sabo_tree_ctx->remaining_no_prev = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) (num_processes + 1) *
+              (size_t) num_sockets);
+    __sabo_tree_ctx->remaining_prev = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_processes);
+    __sabo_tree_ctx->last_num_threads = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_processes);
+    __sabo_tree_ctx->last_socket_ids = (int *) ptr;
+
+    tree_init_candidate(&(__sabo_tree_ctx->incumbent), num_processes);
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_processes);
+    __sabo_tree_ctx->placement = (int *) ptr;
+
+    __sabo_tree_ctx->dp_num_slots = DECISION_DP_NUM_SLOTS;
+    ptr = xzalloc(sizeof(int) * DECISION_DP_NUM_SLOTS *
+              (size_t) (DECISION_DP_HEADER + 1 + num_sockets));
+    __sabo_tree_ctx->dp_slots = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) (num_processes + 1) *
+              (size_t) (num_sockets + 1));
+    __sabo_tree_ctx->dp_keys = (int *) ptr;
+
+    decision_tree_set_socket_move_costs(NULL);
+
+    flags = env_get_solver_flags();
+    decision_tree_set_flags((0 > flags) ? DECISION_TREE_FLAGS_DEFAULT : flags);
+
+    decision_tree_set_solver(tree_get_env_solver());
+    decision_tree_set_num_threads(env_get_solver_num_threads());
+    decision_tree_set_budget(env_get_solver_budget());
+    decision_tree_set_cache_size(env_get_solver_cache_size());
 }
 
 void decision_tree_fini(void)
 {
-    tree_fini_nodes_list();
+    if (NULL == __sabo_tree_ctx)
+        return;
+
+    tree_fini_parallel();
+
+    xfree(__sabo_tree_ctx->num_cores);
+    xfree(__sabo_tree_ctx->move_costs);
+    xfree(__sabo_tree_ctx->min_move_costs);
+    xfree(__sabo_tree_ctx->processes);
+    xfree(__sabo_tree_ctx->same_as_prev);
+    xfree(__sabo_tree_ctx->last_prev_idx);
+    xfree(__sabo_tree_ctx->remaining_threads);
+    xfree(__sabo_tree_ctx->remaining_no_prev);
+    xfree(__sabo_tree_ctx->remaining_prev);
+    xfree(__sabo_tree_ctx->last_num_threads);
+    xfree(__sabo_tree_ctx->last_socket_ids);
+    tree_fini_candidate(&(__sabo_tree_ctx->incumbent));
+    xfree(__sabo_tree_ctx->placement);
+    xfree(__sabo_tree_ctx->dp_slots);
+    xfree(__sabo_tree_ctx->dp_keys);
+    tree_fini_cache();
 
     xfree(__sabo_tree_ctx);
     __sabo_tree_ctx = NULL;
@@ -5,13 +5,62 @@
 #ifndef include_tree_h
 #define include_tree_h
 
+#include <stdint.h>
+
 #include "list.h"
 #include "sabo_internal.h"
 
+enum decision_tree_solver {
+    DECISION_TREE_SOLVER_COPY = 0,    /* node copying branch & cut */
+    DECISION_TREE_SOLVER_BACKTRACK,    /* copy-free backtracking */
+    DECISION_TREE_SOLVER_DP,    /* exact dynamic programming */
+    DECISION_TREE_SOLVER_AUTO,    /* dp or backtrack from the topology */
+    DECISION_TREE_NUM_SOLVERS
+};
+
+/* Backtracking solver optimizations */
+#define DECISION_TREE_FLAG_SYMMETRY    (1 << 0)
+#define DECISION_TREE_FLAG_TRANSPOSITION    (1 << 1)
+#define DECISION_TREE_FLAG_BOUND    (1 << 2)
+#define DECISION_TREE_FLAG_INCREMENTAL    (1 << 3)
+
+#define DECISION_TREE_FLAGS_DEFAULT    (DECISION_TREE_FLAG_SYMMETRY | \
+                     DECISION_TREE_FLAG_TRANSPOSITION | \
+                     DECISION_TREE_FLAG_BOUND | \
+                     DECISION_TREE_FLAG_INCREMENTAL)
+
+/* Counters of the last decision_tree_compute_placement call */
+struct decision_tree_stats {
+    uint64_t num_nodes;        /* explored tree nodes */
+    uint64_t num_candidates;    /* better placements found */
+    uint64_t num_copy_bytes;    /* bytes copied by node and candidate */
+    uint64_t num_allocs;        /* tree nodes allocated */
+    uint64_t num_symmetric_cuts;    /* subtrees skipped by symmetry */
+    uint64_t num_cuts;        /* subtrees cut by bound */
+    uint64_t num_bound_cuts;    /* subtrees cut by remaining demand */
+    uint64_t num_tt_hits;        /* transposition table hits */
+    uint64_t num_tt_misses;        /* transposition table misses */
+    uint64_t num_reuses;        /* previous placement reused */
+    uint64_t num_cache_hits;    /* placement cache hits */
+};
+
 void decision_tree_init(const int num_sockets, const int num_cores_per_socket,
             const int num_processes);
 void decision_tree_fini(void);
 
+void decision_tree_set_num_threads(const int num_threads);
+void decision_tree_set_budget(const int num_nodes);
+void decision_tree_set_cache_size(const int num_entries);
+void decision_tree_set_socket_num_cores(const int *num_cores);
+void decision_tree_set_socket_move_costs(const int *costs);
+void decision_tree_set_flags(const int flags);
+void decision_tree_set_num_processes(const int num_processes);
+void decision_tree_set_solver(const enum decision_tree_solver solver);
+enum decision_tree_solver decision_tree_get_solver(void);
+enum decision_tree_solver decision_tree_get_active_solver(void);
+const char *decision_tree_get_solver_name(const enum decision_tree_solver solver);
+
 void decision_tree_compute_placement(struct core_process *processes);
+void decision_tree_get_stats(struct decision_tree_stats *stats);
 
 #endif /* #ifndef include_tree_h */
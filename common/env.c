@@ -14,6 +14,13 @@
 #define ENV_DEFAULT_PERIODIC 0
 #define ENV_DEFAULT_NUM_STEPS_EXCHANGED 1
 #define ENV_DEFAULT_NO_REBALANCE 0
+#define ENV_DEFAULT_SOLVER_NUM_THREADS 1
+#define ENV_DEFAULT_SOLVER_BUDGET 0
+#define ENV_DEFAULT_SOLVER_CACHE_SIZE 16
+#define ENV_DEFAULT_TOPO_DEPTH 2
+#define ENV_DEFAULT_SPANNING 0
+#define ENV_DEFAULT_MEMORY_FOLLOW 0
+#define ENV_DEFAULT_MEMORY_FOLLOW_MAX_MB 0
 
 
 int env_get_implicit_balancing(void)
@@ -126,6 +133,131 @@ int env_get_no_rebalance(void)
     return env_no_rebalance;
 }
 
+int env_get_solver_num_threads(void)
+{
+    const char *env;
+    static int env_solver_num_threads = -2; /* uninitialized value */
+
+    if (likely(-2 != env_solver_num_threads)) /* already query */
+        return env_solver_num_threads;
+
+    env_solver_num_threads = ENV_DEFAULT_SOLVER_NUM_THREADS;
+    if (NULL != (env = getenv("SABO_SOLVER_NUM_THREADS")))
+        env_solver_num_threads = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_solver_num_threads = %d",
+          env_solver_num_threads);
+
+    return env_solver_num_threads;
+}
+
+int env_get_solver_budget(void)
+{
+    const char *env;
+    static int env_solver_budget = -2; /* uninitialized value */
+
+    if (likely(-2 != env_solver_budget)) /* already query */
+        return env_solver_budget;
+
+    env_solver_budget = ENV_DEFAULT_SOLVER_BUDGET;
+    if (NULL != (env = getenv("SABO_SOLVER_BUDGET")))
+        env_solver_budget = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_solver_budget = %d", env_solver_budget);
+
+    return env_solver_budget;
+}
+
+int env_get_solver_cache_size(void)
+{
+    const char *env;
+    static int env_solver_cache_size = -2; /* uninitialized value */
+
+    if (likely(-2 != env_solver_cache_size)) /* already query */
+        return env_solver_cache_size;
+
+    env_solver_cache_size = ENV_DEFAULT_SOLVER_CACHE_SIZE;
+    if (NULL != (env = getenv("SABO_SOLVER_CACHE_SIZE")))
+        env_solver_cache_size = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_solver_cache_size = %d",
+          env_solver_cache_size);
+
+    return env_solver_cache_size;
+}
+
+int env_get_topo_depth(void)
+{
+    const char *env;
+    static int env_topo_depth = -2; /* uninitialized value */
+
+    if (likely(-2 != env_topo_depth)) /* already query */
+        return env_topo_depth;
+
+    env_topo_depth = ENV_DEFAULT_TOPO_DEPTH;
+    if (NULL != (env = getenv("SABO_TOPO_DEPTH")))
+        env_topo_depth = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_topo_depth = %d", env_topo_depth);
+
+    return env_topo_depth;
+}
+
+int env_get_spanning(void)
+{
+    const char *env;
+    static int env_spanning = -2; /* uninitialized value */
+
+    if (likely(-2 != env_spanning)) /* already query */
+        return env_spanning;
+
+    env_spanning = ENV_DEFAULT_SPANNING;
+    if (NULL != (env = getenv("SABO_SPANNING")))
+        env_spanning = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_spanning = %s",
+          (env_spanning) ? "true" : "false");
+
+    return env_spanning;
+}
+
+int env_get_memory_follow(void)
+{
+    const char *env;
+    static int env_memory_follow = -2; /* uninitialized value */
+
+    if (likely(-2 != env_memory_follow)) /* already query */
+        return env_memory_follow;
+
+    env_memory_follow = ENV_DEFAULT_MEMORY_FOLLOW;
+    if (NULL != (env = getenv("SABO_MEMORY_FOLLOW")))
+        env_memory_follow = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_memory_follow = %s",
+          (env_memory_follow) ? "true" : "false");
+
+    return env_memory_follow;
+}
+
+/* Most MB migrated by a balancing step, 0 for no limit */
+int env_get_memory_follow_max_mb(void)
+{
+    const char *env;
+    static int env_memory_follow_max_mb = -2; /* uninitialized value */
+
+    if (likely(-2 != env_memory_follow_max_mb)) /* already query */
+        return env_memory_follow_max_mb;
+
+    env_memory_follow_max_mb = ENV_DEFAULT_MEMORY_FOLLOW_MAX_MB;
+    if (NULL != (env = getenv("SABO_MEMORY_FOLLOW_MAX_MB")))
+        env_memory_follow_max_mb = atoi(env);
+
+    debug(LOG_DEBUG_ENV, "env_memory_follow_max_mb = %d",
+          env_memory_follow_max_mb);
+
+    return env_memory_follow_max_mb;
+}
+
 int env_get_world_num_tasks(void)
 {
     const char *env;
@@ -208,6 +340,56 @@ void env_get_shared_node_filename(char *string, size_t size)
           string);
 }
 
+int env_get_solver_flags(void)
+{
+    const char *env;
+    static int env_solver_flags = -2; /* uninitialized value */
+
+    if (likely(-2 != env_solver_flags)) /* already query */
+        return env_solver_flags;
+
+    env_solver_flags = -1; /* solver defaults */
+    if (NULL != (env = getenv("SABO_SOLVER_FLAGS")))
+        env_solver_flags = (int) strtol(env, NULL, 16);
+
+    debug(LOG_DEBUG_ENV, "env_solver_flags = %d", env_solver_flags);
+
+    return env_solver_flags;
+}
+
+void env_get_solver(char *string, size_t size)
+{
+    const char *env;
+
+    string[0] = '\0';
+    if (NULL != (env = getenv("SABO_SOLVER")))
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_solver = '%s'", string);
+}
+
+void env_get_smt(char *string, size_t size)
+{
+    const char *env;
+
+    string[0] = '\0';
+    if (NULL != (env = getenv("SABO_SMT")))
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_smt = '%s'", string);
+}
+
+void env_get_binding(char *string, size_t size)
+{
+    const char *env;
+
+    string[0] = '\0';
+    if (NULL != (env = getenv("SABO_BINDING")))
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_binding = '%s'", string);
+}
+
 int env_get_hwloc_xml_file(char *string, size_t size)
 {
     const char *env;
@@ -227,6 +409,84 @@ int env_get_hwloc_xml_file(char *string, size_t size)
     return found;
 }
 
+int env_get_cpu_capacity_file(char *string, size_t size)
+{
+    const char *env;
+    int found = -1;
+
+    string[0] = '\0';
+
+    if (NULL != (env = getenv("SABO_CPU_CAPACITY_FILENAME")))
+        found = 0;
+
+    if (!found)
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_cpu_capacity_filename = '%s'",
+          string);
+
+    return found;
+}
+
+/* Node local directory of the topology cache */
+int env_get_topo_cache_dir(char *string, size_t size)
+{
+    const char *env;
+    int found = -1;
+
+    string[0] = '\0';
+
+    if (NULL != (env = getenv("SABO_TOPO_CACHE_DIR")))
+        found = 0;
+
+    if (!found)
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_topo_cache_dir = '%s'",
+          string);
+
+    return found;
+}
+
+/* Cpus kept for the system (core specialisation), as a cpu list */
+int env_get_reserved_cores(char *string, size_t size)
+{
+    const char *env;
+    int found = -1;
+
+    string[0] = '\0';
+
+    if (NULL != (env = getenv("SABO_RESERVED_CORES")))
+        found = 0;
+
+    if (!found)
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_reserved_cores = '%s'",
+          string);
+
+    return found;
+}
+
+int env_get_socket_distances(char *string, size_t size)
+{
+    const char *env;
+    int found = -1;
+
+    string[0] = '\0';
+
+    if (NULL != (env = getenv("SABO_SOCKET_DISTANCES")))
+        found = 0;
+
+    if (!found)
+        (void) snprintf(string, size, "%s", env);
+
+    debug(LOG_DEBUG_ENV, "env_socket_distances = '%s'",
+          string);
+
+    return found;
+}
+
 void env_variables_init(void)
 {
     int val;
@@ -245,6 +505,31 @@ void env_variables_init(void)
     (void) env_get_periodic();
     (void) env_get_num_steps_exchanged();
 
+    val = env_get_solver_num_threads();
+    if (0 >= val)
+        error("invalid solver num threads value (%d)", val);
+
+    (void) env_get_solver_flags();
+
+    val = env_get_solver_budget();
+    if (0 > val)
+        error("invalid solver budget value (%d)", val);
+
+    val = env_get_solver_cache_size();
+    if (0 > val)
+        error("invalid solver cache size value (%d)", val);
+
+    val = env_get_topo_depth();
+    if (0 > val)
+        error("invalid topology depth value (%d)", val);
+
+    (void) env_get_spanning();
+    (void) env_get_memory_follow();
+
+    val = env_get_memory_follow_max_mb();
+    if (0 > val)
+        error("invalid memory follow max MB value (%d)", val);
+
     (void) env_get_node_task_id();
     (void) env_get_node_num_tasks();
 
@@ -18,11 +18,26 @@ int env_get_node_task_id(void);
 
 void env_get_shared_node_filename(char *string, size_t size);
 int env_get_hwloc_xml_file(char *string, size_t size);
+int env_get_cpu_capacity_file(char *string, size_t size);
+int env_get_reserved_cores(char *string, size_t size);
+int env_get_topo_cache_dir(char *string, size_t size);
+int env_get_socket_distances(char *string, size_t size);
 
 int env_get_no_rebalance(void);
 int env_get_stepbal(void);
 int env_get_periodic(void);
 int env_get_num_steps_exchanged(void);
+int env_get_solver_num_threads(void);
+int env_get_solver_budget(void);
+int env_get_solver_cache_size(void);
+int env_get_topo_depth(void);
+int env_get_spanning(void);
+int env_get_memory_follow(void);
+int env_get_memory_follow_max_mb(void);
+void env_get_solver(char *string, size_t size);
+void env_get_smt(char *string, size_t size);
+void env_get_binding(char *string, size_t size);
+int env_get_solver_flags(void);
 int env_get_omp_num_threads(void);
 void env_get_log_debug(void);
 int env_get_implicit_balancing(void);
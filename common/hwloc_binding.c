@@ -22,66 +22,50 @@ void sabo_hwloc_sys_bind_data_free(struct sys_bind_data *data)
         hwloc_bitmap_free((hwloc_bitmap_t) data->data);
 }
 
-void sabo_hwloc_set_thread_affinity(struct sys_bind_data *data)
+/* Core cpusets are precomputed by the topology, a move is a table lookup
+ * and a single syscall. Returns 0 once the thread is bound to the new core,
+ * the binding data are kept otherwise */
+int sabo_hwloc_set_thread_affinity(struct sys_bind_data *data)
 {
     int ret;
-    pthread_t myself;
     hwloc_topology_t topo;
-    hwloc_obj_t core;
-    hwloc_cpuset_t cpuset;
-
-#ifndef NDEBUG
-    char hostname[256];
-    char string[256];
-    char string2[256];
-#endif /* #ifndef NDEBUG */
+    hwloc_const_cpuset_t cpuset;
 
     if (unlikely(NULL == (topo = topo_get_hwloc_topology()))) {
         error("Can't get hwloc topology");
-        return;
+        return -1;
     }
 
     if (unlikely(NULL == data->data)) {
         sabo_hwloc_get_thread_affinity(data);
     }
 
-    myself = pthread_self();
-
-    core = hwloc_get_obj_by_type(topo, HWLOC_OBJ_CORE, data->new_core_id);
-    if (NULL == core) {
+    /* Core ids are the os index of the first usable cpu of the core, as
+     * for the intel runtime affinity masks */
+    cpuset = topo_get_core_cpuset(data->new_core_id);
+    if (unlikely(NULL == cpuset)) {
         error("Can't find core #%d in hwloc topology", data->new_core_id);
-        return;
+        return -1;
     }
 
-#ifndef NDEBUG
-    gethostname(hostname, 256);
-    hwloc_bitmap_list_snprintf(string, 256, (hwloc_bitmap_t) data->data);
-    hwloc_bitmap_list_snprintf(string2, 256, core->cpuset);
-    /* Get affinity from hwloc */
-    debug(LOG_DEBUG_BINDING, "SABO move host: %s pid %d tid %d OS proc "
-          "from %s to %s (cur: %d next: %d)", hostname, getpid(),
-          sys_get_tid(), string, string2, data->cur_core_id,
-          data->new_core_id);
-#endif /* #ifndef NDEBUG */
-
-    cpuset = hwloc_bitmap_dup(core->cpuset);
-    hwloc_bitmap_singlify(cpuset); /* remove HT */
+    debug(LOG_DEBUG_BINDING, "SABO move pid %d tid %d (cur: %d next: %d)",
+          getpid(), sys_get_tid(), data->cur_core_id, data->new_core_id);
 
-    ret = hwloc_set_thread_cpubind(topo, myself, cpuset, 0);
+    ret = hwloc_set_thread_cpubind(topo, pthread_self(), cpuset, 0);
 
     if (0 != ret) {
-        char *str;
         int error = errno;
-        hwloc_bitmap_asprintf(&str, cpuset);
-        error("Couldn’t bind to cpuset %s: %s\n", str, strerror(error));
-        free(str);
+        error("Couldn’t bind to core #%d: %s\n", data->new_core_id,
+              strerror(error));
+        return -1;
     }
 
     hwloc_bitmap_copy((hwloc_bitmap_t) data->data, cpuset);
-    hwloc_bitmap_free(cpuset);
 
     data->cur_core_id = data->new_core_id;
     data->new_core_id = -1;
+
+    return 0;
 }
 
 void sabo_hwloc_get_thread_affinity(struct sys_bind_data *data)
@@ -89,7 +73,6 @@ void sabo_hwloc_get_thread_affinity(struct sys_bind_data *data)
     int ret;
     pthread_t myself;
     hwloc_topology_t topo;
-    hwloc_cpuset_t cpuset;
 
     if (NULL == (topo = topo_get_hwloc_topology())) {
         error("Can't get hwloc topology");
@@ -101,16 +84,12 @@ void sabo_hwloc_get_thread_affinity(struct sys_bind_data *data)
     }
 
     myself = pthread_self();
-    
-    cpuset = hwloc_bitmap_alloc();
-    
-    ret = hwloc_get_thread_cpubind(topo, myself, cpuset, 0);
+
+    ret = hwloc_get_thread_cpubind(topo, myself, (hwloc_bitmap_t) data->data,
+                       0);
 
     if (0 != ret) {
         int error = errno;
         error("Couldn’t get thread cpubind (%s)", strerror(error)); 
     }
-
-    hwloc_bitmap_copy((hwloc_bitmap_t) data->data, cpuset);
-    hwloc_bitmap_free(cpuset);
 }
@@ -9,7 +9,7 @@
 
 void sabo_hwloc_sys_bind_data_alloc(struct sys_bind_data *data);
 void sabo_hwloc_sys_bind_data_free(struct sys_bind_data *data);
-void sabo_hwloc_set_thread_affinity(struct sys_bind_data *data);
+int sabo_hwloc_set_thread_affinity(struct sys_bind_data *data);
 void sabo_hwloc_get_thread_affinity(struct sys_bind_data *data);
 
 #endif /* ifndef __include_hwloc_binding_h */
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <hwloc.h>
+
+#include "sys.h"
+#include "compiler.h"
+#include "log.h"
+#include "topo.h"
+#include "memory.h"
+#include "sabo_omp.h"
+
+#define MEMORY_MAPS_FILENAME "/proc/self/maps"
+#define MEMORY_MAPS_LINE_SIZE 4096
+
+/* Private anonymous writable mappings hold the heap, the thread stacks
+ * and the large malloc areas, file mappings stay where they are */
+static int memory_is_followed_mapping(const char *perms,
+                      const unsigned long inode,
+                      const char *path)
+{
+    if ('r' != perms[0] || 'w' != perms[1] || 'p' != perms[3])
+        return 0;
+
+    if (0 != inode)
+        return 0;
+
+    return ('\0' == path[0] || 0 == strcmp(path, "[heap]"));
+}
+
+static int memory_get_sockets_nodeset(hwloc_nodeset_t nodeset,
+                      const int *socket_ids,
+                      const int num_sockets)
+{
+    hwloc_topology_t topo = topo_get_hwloc_topology();
+
+    hwloc_bitmap_zero(nodeset);
+
+    for (int i = 0; i < num_sockets; i++) {
+        hwloc_obj_t socket = hwloc_get_obj_by_type(topo, HWLOC_OBJ_PACKAGE,
+                               (unsigned int) socket_ids[i]);
+
+        if (NULL == socket || NULL == socket->nodeset)
+            return -1;
+
+        hwloc_bitmap_or(nodeset, nodeset, socket->nodeset);
+    }
+
+    return hwloc_bitmap_iszero(nodeset) ? -1 : 0;
+}
+
+/* Migrate the pages of the followed mappings from the cursor to the numa
+ * nodes of the sockets, at most max_size bytes (0 for no limit). Returns
+ * 1 once the last mapping is reached, 0 if the cursor stopped on the size
+ * limit and -1 on error */
+static int memory_migrate_mappings(struct memory_follow *follow,
+                   hwloc_const_nodeset_t nodeset,
+                   const size_t max_size)
+{
+    FILE *fd;
+    int ret = 1;
+    char line[MEMORY_MAPS_LINE_SIZE];
+    hwloc_topology_t topo = topo_get_hwloc_topology();
+
+    const int flags = HWLOC_MEMBIND_MIGRATE | HWLOC_MEMBIND_BYNODESET;
+
+    if (NULL == (fd = fopen(MEMORY_MAPS_FILENAME, "r"))) {
+        error("Can't open %s: %s", MEMORY_MAPS_FILENAME, strerror(errno));
+        return -1;
+    }
+
+    while (NULL != fgets(line, sizeof(line), fd)) {
+        int len = 0;
+        size_t size;
+        char perms[5];
+        char *path;
+        unsigned long inode;
+        unsigned long start;
+        unsigned long end;
+
+        if (4 != sscanf(line, "%lx-%lx %4s %*s %*s %lu %n", &start, &end,
+                perms, &inode, &len))
+            continue;
+
+        path = &(line[len]);
+        path[strcspn(path, "\n")] = '\0';
+
+        if (end <= follow->cursor ||
+            !memory_is_followed_mapping(perms, inode, path))
+            continue;
+
+        start = MAX(start, follow->cursor);
+        size = end - start;
+
+        if (0 != max_size) {
+            const size_t left = max_size - follow->size;
+
+            /* Stop on a page boundary, the next pass resumes there */
+            if (left < size) {
+                size = left & ~(page_size() - 1);
+                ret = 0;
+            }
+        }
+
+        if (0 < size &&
+            0 != hwloc_set_area_membind(topo, (const void *) start, size,
+                        nodeset, HWLOC_MEMBIND_BIND, flags)) {
+            error("Can't migrate memory [%#lx-%#lx]: %s", start,
+                  start + size, strerror(errno));
+            ret = -1;
+            break;
+        }
+
+        follow->size += size;
+        follow->cursor = start + size;
+
+        if (0 == ret)
+            break;
+    }
+
+    fclose(fd);
+
+    if (0 != ret)
+        follow->cursor = 0;
+
+    return ret;
+}
+
+/* Move the private memory of the process next to its new sockets, a pass
+ * stopped by max_size resumes from the follow cursor on the next call */
+int memory_follow_sockets(struct memory_follow *follow, const int *socket_ids,
+              const int num_sockets, const size_t max_size)
+{
+    int ret;
+    double elapsed;
+    hwloc_nodeset_t nodeset;
+
+    const double start = sabo_omp_get_wtime();
+
+    follow->size = 0;
+
+    if (unlikely(NULL == topo_get_hwloc_topology())) {
+        error("Can't get hwloc topology");
+        return -1;
+    }
+
+    nodeset = hwloc_bitmap_alloc();
+
+    if (0 != memory_get_sockets_nodeset(nodeset, socket_ids, num_sockets)) {
+        debug(LOG_DEBUG_CORE, "No numa node found for the process sockets");
+        hwloc_bitmap_free(nodeset);
+        follow->cursor = 0;
+        return -1;
+    }
+
+    ret = memory_migrate_mappings(follow, nodeset, max_size);
+
+    hwloc_bitmap_free(nodeset);
+
+    elapsed = sabo_omp_get_wtime() - start;
+
+    follow->total_size += follow->size;
+    follow->total_elapsed += elapsed;
+
+    debug(LOG_DEBUG_PERF, "Migrate %zu KB to %d socket(s) in %.3f usec(s)%s",
+          follow->size >> 10, num_sockets, elapsed * 1000000,
+          (0 == ret) ? " (pending)" : "");
+
+    return ret;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#ifndef __include_memory_h
+#define __include_memory_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct memory_follow {
+    /* Next address to migrate, 0 once every mapping followed the sockets */
+    uintptr_t cursor;
+
+    /* Bytes of the last pass and of all passes */
+    size_t size;
+    size_t total_size;
+    double total_elapsed;
+};
+
+int memory_follow_sockets(struct memory_follow *follow, const int *socket_ids,
+              const int num_sockets, const size_t max_size);
+
+#endif /* #ifndef __include_memory_h */
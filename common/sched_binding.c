@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+#include "sys.h"
+#include "compiler.h"
+#include "binding.h"
+#include "log.h"
+#include "topo.h"
+#include "sched_binding.h"
+
+/* Linux affinity of the calling thread, hwloc is only used to build the
+ * core masks at topology init */
+
+void sabo_sched_sys_bind_data_alloc(struct sys_bind_data *data)
+{
+    data->data = xzalloc(sizeof(cpu_set_t));
+}
+
+void sabo_sched_sys_bind_data_free(struct sys_bind_data *data)
+{
+    if (NULL != data->data)
+        xfree(data->data);
+    data->data = NULL;
+}
+
+/* A move is a lookup of the precomputed core mask and a single syscall,
+ * without any bitmap conversion. Returns 0 once the thread is bound to the
+ * new core, the binding data are kept otherwise */
+int sabo_sched_set_thread_affinity(struct sys_bind_data *data)
+{
+    const cpu_set_t *mask;
+
+    if (unlikely(NULL == data->data)) {
+        sabo_sched_get_thread_affinity(data);
+    }
+
+    mask = topo_get_core_mask(data->new_core_id);
+    if (unlikely(NULL == mask)) {
+        error("Can't find core #%d mask", data->new_core_id);
+        return -1;
+    }
+
+    debug(LOG_DEBUG_BINDING, "SABO move pid %d tid %d (cur: %d next: %d)",
+          getpid(), sys_get_tid(), data->cur_core_id, data->new_core_id);
+
+    /* pid 0 is the calling thread */
+    if (0 != sched_setaffinity(0, sizeof(cpu_set_t), mask)) {
+        int error = errno;
+        error("Couldn’t bind to core #%d: %s", data->new_core_id,
+              strerror(error));
+        return -1;
+    }
+
+    memcpy(data->data, mask, sizeof(cpu_set_t));
+
+    data->cur_core_id = data->new_core_id;
+    data->new_core_id = -1;
+
+    return 0;
+}
+
+void sabo_sched_get_thread_affinity(struct sys_bind_data *data)
+{
+    if (unlikely(NULL == data->data)) {
+        sabo_sched_sys_bind_data_alloc(data);
+    }
+
+    if (0 != sched_getaffinity(0, sizeof(cpu_set_t), (cpu_set_t *) data->data)) {
+        int error = errno;
+        error("Couldn’t get thread affinity (%s)", strerror(error));
+    }
+}
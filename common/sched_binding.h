@@ -0,0 +1,15 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#ifndef __include_sched_binding_h
+#define __include_sched_binding_h
+
+#include "binding.h"
+
+void sabo_sched_sys_bind_data_alloc(struct sys_bind_data *data);
+void sabo_sched_sys_bind_data_free(struct sys_bind_data *data);
+int sabo_sched_set_thread_affinity(struct sys_bind_data *data);
+void sabo_sched_get_thread_affinity(struct sys_bind_data *data);
+
+#endif /* ifndef __include_sched_binding_h */
@@ -4,17 +4,120 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
 #include <hwloc.h>
+#include <hwloc/glibc-sched.h>
 
 #include "sys.h"
 #include "log.h"
 #include "topo.h"
 #include "env.h"
+#include "sabo_omp.h"
+
+/* Node local ranks wait for the topology cache written by the first one */
+#define TOPO_CACHE_WAIT_USEC 1000
+#define TOPO_CACHE_TIMEOUT_USEC 10000000
 
 static hwloc_topology_t sabo_topology = NULL;
 
 static int **sabo_topo_core_id_by_socket = NULL;
 
+/* Binding masks of each cpu of the usable cores: the single cpu cpuset
+ * and the same cpu as a raw affinity mask, NULL for other cpus. Built
+ * once, read only when threads are rebound. A cpu_set_t only holds
+ * CPU_SETSIZE cpus, there is no raw mask on larger nodes */
+static int sabo_topo_num_cpus = 0;
+static hwloc_bitmap_t *sabo_topo_cpuset_by_core_id = NULL;
+static cpu_set_t *sabo_topo_mask_by_core_id = NULL;
+
+/* Hardware threads of each core id, the core id being the first one */
+static int sabo_topo_smt_policy = TOPO_SMT_OFF;
+static int sabo_topo_num_smt = 1;
+static int *sabo_topo_num_pus_by_core_id = NULL;
+static int *sabo_topo_pu_ids_by_core_id = NULL;
+
+static const char *topo_smt_policy_names[TOPO_NUM_SMT_POLICIES] = {
+    "off",
+    "fill",
+    "rank"
+};
+
+/* Usable cores of each socket, sockets may differ when some cores are
+ * hidden by the resource manager */
+static int *sabo_topo_num_cores_by_socket = NULL;
+
+/* Hierarchy levels used below the socket */
+static int sabo_topo_depth = 0;
+
+/* Domain of each socket core at each level, domains are numbered inside
+ * their socket */
+static int **sabo_topo_domain_id_by_socket[TOPO_NUM_LEVELS];
+static int *sabo_topo_num_domains_by_socket[TOPO_NUM_LEVELS];
+
+/* Scratch arrays of the socket layouts, allocated once for the largest
+ * socket so that a rebalance does not allocate. The arrays of processes
+ * hold one process per core and only grow for a socket holding more
+ * processes than cores */
+struct topo_layout_scratch {
+    int max_cores;
+    int max_processes;
+
+    /* topo_pack_pieces */
+    int *pack_order;
+    int *pack_free_cores;
+
+    /* topo_layout_domain, one slice per level */
+    int *domain_child_ids;
+    int *domain_children;
+    int *domain_sizes;
+    int *domain_child_cores;
+    int *domain_assign;
+    int *domain_child_pieces;
+
+    /* topo_layout_cores and topo_layout_socket */
+    int *pieces;
+    int *offsets;
+    int *cores;
+
+    /* Oversubscribed sockets */
+    int *fit;
+    int *fit_ids;
+
+    /* topo_stable_assign */
+    int *targets;
+    int *target_of;
+    int *counts;
+
+    /* topo_stable_assign_capacities */
+    int *order;
+    int *starts;
+    int *sorted;
+    int *class_threads;
+
+    /* topo_stable_layout_socket */
+    int *stable_cores;
+    int *assigned;
+    int *process_offsets;
+};
+
+static struct topo_layout_scratch sabo_topo_scratch;
+
+/* Relative throughput of each socket core, TOPO_CAPACITY_SCALE for the
+ * fastest cores of the node */
+static int **sabo_topo_capacity_by_socket = NULL;
+static int *sabo_topo_capacity_of_socket = NULL;
+
+/* Memory distance from each socket to each socket */
+static int *sabo_topo_socket_distances = NULL;
+
+static const hwloc_obj_type_t topo_level_types[TOPO_NUM_LEVELS] = {
+    HWLOC_OBJ_NUMANODE,
+    HWLOC_OBJ_L3CACHE
+};
+
 hwloc_topology_t topo_get_hwloc_topology(void)
 {
     return sabo_topology;
@@ -28,8 +131,8 @@ int topo_get_socket_id_from_core_id(const int core_id)
     if (unlikely(NULL == sabo_topology))
         fatal_error("No hwloc topology init");
 
-    core = hwloc_get_obj_by_type(sabo_topology, HWLOC_OBJ_CORE,
-                     (unsigned int) core_id);
+    /* Core ids are os cpu indexes, see topo_get_socket_core_id */
+    core = hwloc_get_pu_obj_by_os_index(sabo_topology, (unsigned int) core_id);
     assert(NULL != core);
 
     socket = hwloc_get_next_obj_covering_cpuset_by_type(sabo_topology,
@@ -68,7 +171,7 @@ int topo_get_socket_core_id(int socket_id, int local_core_id)
     assert(local_core_id >= 0);
 
     if (likely(NULL != sabo_topo_core_id_by_socket)) {
-        assert(local_core_id < topo_get_num_cores_per_socket());
+        assert(local_core_id < topo_get_socket_num_cores(socket_id));
         return sabo_topo_core_id_by_socket[socket_id][local_core_id];
     }
 
@@ -81,7 +184,7 @@ int topo_get_socket_core_id(int socket_id, int local_core_id)
     for (int i = 0; i < num_sockets; i++) {
         hwloc_obj_t socket;
 
-        const int count = topo_get_num_cores_per_socket();
+        const int count = topo_get_socket_num_cores(i);
 
         socket = hwloc_get_obj_by_type(sabo_topology, HWLOC_OBJ_PACKAGE,
                            (unsigned int) i);
@@ -118,6 +221,198 @@ int topo_get_socket_core_id(int socket_id, int local_core_id)
     return sabo_topo_core_id_by_socket[socket_id][local_core_id];
 }
 
+static void topo_fini_core_ids(void)
+{
+    if (NULL == sabo_topo_core_id_by_socket)
+        return;
+
+    for (int i = 0; i < topo_get_num_sockets(); i++)
+        xfree(sabo_topo_core_id_by_socket[i]);
+
+    xfree(sabo_topo_core_id_by_socket);
+    sabo_topo_core_id_by_socket = NULL;
+}
+
+hwloc_const_cpuset_t topo_get_core_cpuset(const int core_id)
+{
+    if (unlikely(0 > core_id || sabo_topo_num_cpus <= core_id))
+        return NULL;
+
+    return sabo_topo_cpuset_by_core_id[core_id];
+}
+
+const cpu_set_t *topo_get_core_mask(const int core_id)
+{
+    if (unlikely(0 > core_id || sabo_topo_num_cpus <= core_id ||
+             NULL == sabo_topo_mask_by_core_id ||
+             NULL == sabo_topo_cpuset_by_core_id[core_id]))
+        return NULL;
+
+    return &(sabo_topo_mask_by_core_id[core_id]);
+}
+
+enum topo_smt_policy topo_get_smt_policy(void)
+{
+    return (enum topo_smt_policy) sabo_topo_smt_policy;
+}
+
+int topo_get_num_smt(void)
+{
+    return sabo_topo_num_smt;
+}
+
+int topo_get_core_num_pus(const int core_id)
+{
+    assert(0 <= core_id && sabo_topo_num_cpus > core_id);
+
+    return sabo_topo_num_pus_by_core_id[core_id];
+}
+
+int topo_get_core_pu_id(const int core_id, const int idx)
+{
+    assert(0 <= idx && topo_get_core_num_pus(core_id) > idx);
+
+    return sabo_topo_pu_ids_by_core_id[core_id * sabo_topo_num_smt + idx];
+}
+
+static void topo_init_smt_policy(void)
+{
+    char string[64];
+
+    sabo_topo_smt_policy = TOPO_SMT_OFF;
+
+    env_get_smt(string, sizeof(string));
+    if ('\0' == string[0])
+        return;
+
+    for (int i = 0; i < TOPO_NUM_SMT_POLICIES; i++) {
+        if (0 == strcmp(string, topo_smt_policy_names[i])) {
+            sabo_topo_smt_policy = i;
+            return;
+        }
+    }
+
+    error("Unknown smt policy '%s'", string);
+}
+
+/* Core object of a core id */
+static hwloc_obj_t topo_get_core_obj(const int core_id)
+{
+    hwloc_obj_t pu;
+
+    pu = hwloc_get_pu_obj_by_os_index(sabo_topology, (unsigned int) core_id);
+    assert(NULL != pu);
+
+    return hwloc_get_ancestor_obj_by_type(sabo_topology, HWLOC_OBJ_CORE, pu);
+}
+
+static void topo_init_core_cpu(const int cpu)
+{
+    hwloc_bitmap_t cpuset;
+
+    cpuset = hwloc_bitmap_alloc();
+    hwloc_bitmap_only(cpuset, (unsigned int) cpu);
+
+    if (NULL != sabo_topo_mask_by_core_id)
+        hwloc_cpuset_to_glibc_sched_affinity(sabo_topology, cpuset,
+                             &(sabo_topo_mask_by_core_id[cpu]),
+                             sizeof(cpu_set_t));
+
+    sabo_topo_cpuset_by_core_id[cpu] = cpuset;
+}
+
+static void topo_init_core_cpusets(void)
+{
+    const hwloc_const_cpuset_t cpuset =
+        hwloc_topology_get_complete_cpuset(sabo_topology);
+
+    sabo_topo_num_cpus = hwloc_bitmap_last(cpuset) + 1;
+    if (0 >= sabo_topo_num_cpus)
+        sabo_topo_num_cpus = 0;
+
+    sabo_topo_cpuset_by_core_id =
+        xzalloc(sizeof(hwloc_bitmap_t) * (size_t) MAX(sabo_topo_num_cpus, 1));
+    sabo_topo_mask_by_core_id = NULL;
+    if (CPU_SETSIZE >= sabo_topo_num_cpus)
+        sabo_topo_mask_by_core_id =
+            xzalloc(sizeof(cpu_set_t) * (size_t) MAX(sabo_topo_num_cpus, 1));
+    sabo_topo_num_pus_by_core_id =
+        xzalloc(sizeof(int) * (size_t) MAX(sabo_topo_num_cpus, 1));
+
+    /* Largest number of hardware threads of a core */
+    sabo_topo_num_smt = 1;
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        for (int j = 0; j < topo_get_socket_num_cores(i); j++) {
+            const hwloc_obj_t core =
+                topo_get_core_obj(topo_get_socket_core_id(i, j));
+
+            if (NULL != core)
+                sabo_topo_num_smt = MAX(sabo_topo_num_smt,
+                            hwloc_bitmap_weight(core->cpuset));
+        }
+    }
+
+    sabo_topo_pu_ids_by_core_id =
+        xzalloc(sizeof(int) * (size_t) MAX(sabo_topo_num_cpus, 1) *
+            (size_t) sabo_topo_num_smt);
+
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        for (int j = 0; j < topo_get_socket_num_cores(i); j++) {
+            int pu_id;
+            int num_pus = 0;
+
+            const int core_id = topo_get_socket_core_id(i, j);
+            const hwloc_obj_t core = topo_get_core_obj(core_id);
+            int *pu_ids =
+                &(sabo_topo_pu_ids_by_core_id[core_id * sabo_topo_num_smt]);
+
+            assert(0 <= core_id && sabo_topo_num_cpus > core_id);
+
+            /* Core ids are already the first cpu of their core */
+            if (NULL == core) {
+                pu_ids[num_pus++] = core_id;
+                topo_init_core_cpu(core_id);
+            } else {
+                hwloc_bitmap_foreach_begin(pu_id, core->cpuset) {
+                    pu_ids[num_pus++] = pu_id;
+                    topo_init_core_cpu(pu_id);
+                } hwloc_bitmap_foreach_end();
+            }
+
+            sabo_topo_num_pus_by_core_id[core_id] = num_pus;
+        }
+    }
+
+    topo_init_smt_policy();
+
+    debug(LOG_DEBUG_TOPO, "Detected %d hardware thread(s) per core, smt "
+          "policy '%s'", sabo_topo_num_smt,
+          topo_smt_policy_names[sabo_topo_smt_policy]);
+}
+
+static void topo_fini_core_cpusets(void)
+{
+    if (NULL == sabo_topo_cpuset_by_core_id)
+        return;
+
+    for (int i = 0; i < sabo_topo_num_cpus; i++) {
+        if (NULL != sabo_topo_cpuset_by_core_id[i])
+            hwloc_bitmap_free(sabo_topo_cpuset_by_core_id[i]);
+    }
+
+    xfree(sabo_topo_cpuset_by_core_id);
+    xfree(sabo_topo_mask_by_core_id);
+    xfree(sabo_topo_num_pus_by_core_id);
+    xfree(sabo_topo_pu_ids_by_core_id);
+
+    sabo_topo_cpuset_by_core_id = NULL;
+    sabo_topo_mask_by_core_id = NULL;
+    sabo_topo_num_pus_by_core_id = NULL;
+    sabo_topo_pu_ids_by_core_id = NULL;
+    sabo_topo_num_cpus = 0;
+    sabo_topo_num_smt = 1;
+}
+
 int topo_get_num_cores(void)
 {
     static int num_cores = -2; /* uninitialized value */
@@ -134,13 +429,23 @@ int topo_get_num_cores(void)
     return num_cores;
 }
 
-int topo_get_num_cores_per_socket(void)
+int topo_get_socket_num_cores(const int socket_id)
 {
-    static int num_cores_per_socket = -2; /* uninitialized value */
-    const int num_sockets = topo_get_num_sockets();
+    int num_sockets;
 
-    if (-2 != num_cores_per_socket) /* already query */
-        return num_cores_per_socket;
+    assert(socket_id >= 0);
+    assert(socket_id < topo_get_num_sockets());
+
+    if (likely(NULL != sabo_topo_num_cores_by_socket))
+        return sabo_topo_num_cores_by_socket[socket_id];
+
+    if (unlikely(NULL == sabo_topology))
+        fatal_error("No hwloc topology init");
+
+    num_sockets = topo_get_num_sockets();
+
+    sabo_topo_num_cores_by_socket = xzalloc(sizeof(int) *
+                        (size_t) num_sockets);
 
     for (int i = 0; i < num_sockets; i++) {
         int num_cores;
@@ -157,16 +462,30 @@ int topo_get_num_cores_per_socket(void)
         debug(LOG_DEBUG_TOPO, "Detected %d num core(s) on socket #%d",
               num_cores, i);
 
-        if (-2 == num_cores_per_socket) {
-            num_cores_per_socket = num_cores;
-            continue;
-        }
+        sabo_topo_num_cores_by_socket[i] = num_cores;
+    }
 
-        if (num_cores_per_socket != num_cores) {
-            error("Different num cores per socket detected");
-            num_cores_per_socket = -1;
-            break;
-        }
+    return sabo_topo_num_cores_by_socket[socket_id];
+}
+
+/* Cores of the largest socket */
+int topo_get_num_cores_per_socket(void)
+{
+    static int num_cores_per_socket = -2; /* uninitialized value */
+    const int num_sockets = topo_get_num_sockets();
+
+    if (-2 != num_cores_per_socket) /* already query */
+        return num_cores_per_socket;
+
+    num_cores_per_socket = 0;
+
+    for (int i = 0; i < num_sockets; i++) {
+        const int num_cores = topo_get_socket_num_cores(i);
+
+        if (0 < i && num_cores != topo_get_socket_num_cores(0))
+            debug(LOG_DEBUG_TOPO, "Different num cores on socket #%d", i);
+
+        num_cores_per_socket = MAX(num_cores_per_socket, num_cores);
     }
 
     debug(LOG_DEBUG_TOPO, "Detected %d num core(s) per socket",
@@ -175,69 +494,1443 @@ int topo_get_num_cores_per_socket(void)
     return num_cores_per_socket;
 }
 
-int topo_get_thread_cpubind(void)
+/* Usable cores of all sockets */
+int topo_get_num_usable_cores(void)
 {
-    int rc;
-    int core_id;
-    int num_cores;
-    hwloc_cpuset_t cpuset;
+    int num_cores = 0;
 
-    cpuset = hwloc_bitmap_alloc();
-    rc = hwloc_get_cpubind(sabo_topology, cpuset,
-                   HWLOC_CPUBIND_THREAD);
-    if (unlikely(0 != rc))
-        fatal_error("Unexpected error on hwloc_get_cpubind");
+    for (int i = 0; i < topo_get_num_sockets(); i++)
+        num_cores += topo_get_socket_num_cores(i);
 
-    num_cores = hwloc_get_nbobjs_inside_cpuset_by_type(sabo_topology,
-                               cpuset,
-                               HWLOC_OBJ_CORE);
-    /* No real binding */
-    if (num_cores > 1)
-        return -1;
+    return num_cores;
+}
 
-    hwloc_bitmap_singlify(cpuset);
-    core_id = hwloc_bitmap_first(cpuset);
+int topo_get_depth(void)
+{
+    return sabo_topo_depth;
+}
 
-    hwloc_bitmap_free(cpuset);
+int topo_get_socket_num_domains(const int socket_id, const int level)
+{
+    assert(socket_id >= 0);
+    assert(socket_id < topo_get_num_sockets());
+    assert(level >= 0);
+    assert(level < sabo_topo_depth);
 
-    return core_id;
+    return sabo_topo_num_domains_by_socket[level][socket_id];
 }
 
-void topo_init(void)
+int topo_get_socket_domain_id(const int socket_id, const int level,
+                  const int local_core_id)
 {
-    int num_cores;
-    int num_cores_per_socket;
-    int num_sockets;
+    assert(local_core_id >= 0);
+    assert(local_core_id < topo_get_socket_num_cores(socket_id));
+    assert(level >= 0);
+    assert(level < sabo_topo_depth);
+
+    return sabo_topo_domain_id_by_socket[level][socket_id][local_core_id];
+}
+
+int topo_get_socket_core_capacity(const int socket_id, const int local_core_id)
+{
+    assert(socket_id >= 0);
+    assert(socket_id < topo_get_num_sockets());
+    assert(local_core_id >= 0);
+    assert(local_core_id < topo_get_socket_num_cores(socket_id));
+
+    if (unlikely(NULL == sabo_topo_capacity_by_socket))
+        return TOPO_CAPACITY_SCALE;
+
+    return sabo_topo_capacity_by_socket[socket_id][local_core_id];
+}
+
+int topo_get_socket_capacity(const int socket_id)
+{
+    assert(socket_id >= 0);
+    assert(socket_id < topo_get_num_sockets());
+
+    if (unlikely(NULL == sabo_topo_capacity_of_socket))
+        return topo_get_socket_num_cores(socket_id) * TOPO_CAPACITY_SCALE;
+
+    return sabo_topo_capacity_of_socket[socket_id];
+}
+
+int topo_get_socket_distance(const int socket_id, const int other_id)
+{
+    const int num_sockets = topo_get_num_sockets();
+
+    assert(0 <= socket_id && num_sockets > socket_id);
+    assert(0 <= other_id && num_sockets > other_id);
+
+    if (unlikely(NULL == sabo_topo_socket_distances))
+        return (socket_id == other_id) ? TOPO_DISTANCE_LOCAL :
+            TOPO_DISTANCE_REMOTE;
+
+    return sabo_topo_socket_distances[socket_id * num_sockets + other_id];
+}
+
+/* Override is the row major matrix of the socket distances separated by
+ * commas */
+static int topo_read_distances_env(const char *string, int *distances,
+                   const int num_sockets)
+{
+    char *end;
+    const char *ptr = string;
+    int num_values = 0;
+
+    while (num_sockets * num_sockets > num_values) {
+        const long value = strtol(ptr, &end, 10);
+
+        if (ptr == end || 0 >= value || INT_MAX < value)
+            break;
+
+        distances[num_values++] = (int) value;
+
+        ptr = end;
+        if (',' != *ptr)
+            break;
+        ptr++;
+    }
+
+    if (num_sockets * num_sockets != num_values || '\0' != *ptr) {
+        error("Invalid socket distances '%s', expected %d value(s)", string,
+              num_sockets * num_sockets);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Average latency between the NUMA nodes of each pair of sockets */
+static int topo_read_distances_hwloc(int *distances, const int num_sockets)
+{
+    int found = 0;
+    unsigned int num_distances = 1;
+    struct hwloc_distances_s *matrix;
+    int64_t *sums;
+    int *counts;
+
+    if (0 != hwloc_distances_get_by_type(sabo_topology, HWLOC_OBJ_NUMANODE,
+                         &num_distances, &matrix,
+                         HWLOC_DISTANCES_KIND_MEANS_LATENCY,
+                         0) || 0 == num_distances)
+        return 0;
+
+    sums = xzalloc(sizeof(int64_t) * (size_t) (num_sockets * num_sockets));
+    counts = xzalloc(sizeof(int) * (size_t) (num_sockets * num_sockets));
+
+    for (unsigned int i = 0; i < matrix->nbobjs; i++) {
+        const hwloc_obj_t src = hwloc_get_ancestor_obj_by_type(sabo_topology,
+                                       HWLOC_OBJ_PACKAGE,
+                                       matrix->objs[i]);
+        if (NULL == src)
+            continue;
+
+        for (unsigned int j = 0; j < matrix->nbobjs; j++) {
+            int idx;
+            const hwloc_obj_t dst =
+                hwloc_get_ancestor_obj_by_type(sabo_topology,
+                                   HWLOC_OBJ_PACKAGE,
+                                   matrix->objs[j]);
+            if (NULL == dst)
+                continue;
+
+            idx = (int) src->logical_index * num_sockets +
+                (int) dst->logical_index;
+
+            sums[idx] += (int64_t) matrix->values[i * matrix->nbobjs + j];
+            counts[idx]++;
+        }
+    }
+
+    hwloc_distances_release(sabo_topology, matrix);
+
+    /* Every pair of sockets needs a distance */
+    for (int i = 0; i < num_sockets * num_sockets; i++) {
+        if (0 == counts[i] || 0 >= sums[i])
+            break;
+
+        distances[i] = (int) ((sums[i] + counts[i] / 2) / counts[i]);
+        found++;
+    }
+
+    xfree(sums);
+    xfree(counts);
+
+    return (num_sockets * num_sockets == found) ? 1 : 0;
+}
+
+static void topo_init_distances(void)
+{
+    int found;
+    char string[PATH_MAX];
+
+    const int num_sockets = topo_get_num_sockets();
+
+    sabo_topo_socket_distances = xzalloc(sizeof(int) *
+                         (size_t) (num_sockets * num_sockets));
+
+    if (!env_get_socket_distances(string, PATH_MAX))
+        found = topo_read_distances_env(string, sabo_topo_socket_distances,
+                        num_sockets);
+    else
+        found = topo_read_distances_hwloc(sabo_topo_socket_distances,
+                          num_sockets);
+
+    if (!found) {
+        xfree(sabo_topo_socket_distances);
+        sabo_topo_socket_distances = NULL;
+    }
+
+    debug(LOG_DEBUG_TOPO, "Detected %s socket distances",
+          (found) ? "measured" : "default");
+}
+
+static void topo_fini_distances(void)
+{
+    xfree(sabo_topo_socket_distances);
+    sabo_topo_socket_distances = NULL;
+}
+
+/* Override file lines are '<cpu> <capacity>', cpu being the os index of a
+ * logical cpu as in /sys/devices/system/cpu/cpu<cpu>/cpu_capacity */
+static int topo_read_capacity_file(const char *filename, int *raw,
+                   const int num_cpus)
+{
+    FILE *file;
+    int cpu;
+    int capacity;
+    int found = 0;
+
+    if (NULL == (file = fopen(filename, "r"))) {
+        error("Cannot open cpu capacity file '%s'", filename);
+        return 0;
+    }
+
+    while (2 == fscanf(file, "%d %d", &cpu, &capacity)) {
+        if (0 > cpu || num_cpus <= cpu || 0 >= capacity) {
+            error("Invalid cpu capacity '%d %d' in '%s'", cpu, capacity,
+                  filename);
+            continue;
+        }
+
+        raw[cpu] = capacity;
+        found++;
+    }
+
+    if (!feof(file))
+        error("Unexpected content in cpu capacity file '%s'", filename);
+
+    fclose(file);
+
+    return found;
+}
+
+/* Arm and RISC-V kernels export the relative capacity of each cpu */
+static int topo_read_capacity_sysfs(int *raw)
+{
+    int found = 0;
     char filename[PATH_MAX];
 
-    hwloc_topology_init(&sabo_topology);
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        for (int j = 0; j < topo_get_socket_num_cores(i); j++) {
+            FILE *file;
+            int capacity;
 
-    if (!env_get_hwloc_xml_file(filename, PATH_MAX))
-        hwloc_topology_set_xml(sabo_topology, filename);
+            const int cpu = topo_get_socket_core_id(i, j);
 
-    hwloc_topology_load(sabo_topology);
+            (void) snprintf(filename, PATH_MAX,
+                    "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
 
-    num_cores = topo_get_num_cores();
-    if (0 > num_cores)
-        fatal_error("Unexpected num cores (%d)", num_cores);
+            if (NULL == (file = fopen(filename, "r")))
+                continue;
 
-    num_sockets = topo_get_num_sockets();
-    if (1 > num_sockets)
-        error("sabo need at least one socket (%d)", num_sockets);
+            if (1 == fscanf(file, "%d", &capacity) && 0 < capacity) {
+                raw[cpu] = capacity;
+                found++;
+            }
 
-    num_cores_per_socket = topo_get_num_cores_per_socket();
-    if (2 > num_cores_per_socket)
-        error("sabo need at least two cores per socket (%d)",
-              num_cores_per_socket);
+            fclose(file);
+        }
+    }
 
-    /* initialiaze array in sequential part */
-    topo_get_socket_core_id(0,0);
+    return found;
 }
 
-void topo_fini(void)
+/* hwloc cpu kinds only rank their efficiency, their maximum frequency gives
+ * the ratio between kinds */
+static int topo_read_capacity_cpukinds(int *raw)
 {
-    if (unlikely(NULL == sabo_topology))
-        fatal_error("No hwloc topology init");
+    int found = 0;
+
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        hwloc_obj_t socket;
+
+        socket = hwloc_get_obj_by_type(sabo_topology, HWLOC_OBJ_PACKAGE,
+                           (unsigned int) i);
+        assert(NULL != socket);
+
+        for (int j = 0; j < topo_get_socket_num_cores(i); j++) {
+            int kind;
+            int efficiency;
+            unsigned int num_infos;
+            struct hwloc_info_s *infos;
+            hwloc_obj_t core;
+
+            const int cpu = topo_get_socket_core_id(i, j);
+
+            core = hwloc_get_obj_inside_cpuset_by_type(sabo_topology,
+                                   socket->cpuset,
+                                   HWLOC_OBJ_CORE,
+                                   (unsigned int) j);
+            assert(NULL != core);
+
+            kind = hwloc_cpukinds_get_by_cpuset(sabo_topology, core->cpuset,
+                                0);
+            if (0 > kind)
+                continue;
+
+            if (0 != hwloc_cpukinds_get_info(sabo_topology,
+                             (unsigned int) kind, NULL,
+                             &efficiency, &num_infos, &infos,
+                             0))
+                continue;
+
+            for (unsigned int k = 0; k < num_infos; k++) {
+                if (0 != strcmp(infos[k].name, "FrequencyMaxMHz"))
+                    continue;
+
+                raw[cpu] = atoi(infos[k].value);
+                found += (0 < raw[cpu]) ? 1 : 0;
+                break;
+            }
+        }
+    }
+
+    return found;
+}
+
+static void topo_init_capacities(void)
+{
+    int *raw;
+    int found;
+    int max = 0;
+    char filename[PATH_MAX];
+
+    const int num_sockets = topo_get_num_sockets();
+    const hwloc_const_cpuset_t cpuset =
+        hwloc_topology_get_complete_cpuset(sabo_topology);
+    const int num_cpus = hwloc_bitmap_last(cpuset) + 1;
+
+    /* Raw capacity of each os cpu, 0 when unknown */
+    raw = xzalloc(sizeof(int) * (size_t) MAX(num_cpus, 1));
+
+    if (!env_get_cpu_capacity_file(filename, PATH_MAX)) {
+        found = topo_read_capacity_file(filename, raw, num_cpus);
+    } else {
+        found = 0;
+
+        /* sysfs does not describe topologies loaded from a file */
+        if (hwloc_topology_is_thissystem(sabo_topology))
+            found = topo_read_capacity_sysfs(raw);
+
+        if (0 == found)
+            found = topo_read_capacity_cpukinds(raw);
+    }
+
+    for (int i = 0; i < MAX(num_cpus, 1); i++)
+        max = MAX(max, raw[i]);
+
+    debug(LOG_DEBUG_TOPO, "Detected %d core capacity(ies) max %d", found,
+          max);
+
+    sabo_topo_capacity_by_socket = xzalloc(sizeof(int *) *
+                           (size_t) num_sockets);
+    sabo_topo_capacity_of_socket = xzalloc(sizeof(int) * (size_t) num_sockets);
+
+    for (int i = 0; i < num_sockets; i++) {
+        const int num_cores = topo_get_socket_num_cores(i);
+
+        sabo_topo_capacity_by_socket[i] = xzalloc(sizeof(int) *
+                              (size_t) MAX(num_cores, 1));
+
+        for (int j = 0; j < num_cores; j++) {
+            int capacity = TOPO_CAPACITY_SCALE;
+
+            const int cpu = topo_get_socket_core_id(i, j);
+
+            /* Unknown cores run as fast as the fastest ones */
+            if (0 < max && 0 < raw[cpu])
+                capacity = (int) (((int64_t) raw[cpu] * TOPO_CAPACITY_SCALE +
+                           max / 2) / max);
+
+            capacity = MAX(capacity, 1);
+
+            sabo_topo_capacity_by_socket[i][j] = capacity;
+            sabo_topo_capacity_of_socket[i] += capacity;
+        }
+
+        debug(LOG_DEBUG_TOPO, "Detected capacity %d on socket #%d",
+              sabo_topo_capacity_of_socket[i], i);
+    }
+
+    xfree(raw);
+}
+
+static void topo_fini_capacities(void)
+{
+    if (NULL == sabo_topo_capacity_by_socket)
+        return;
+
+    for (int i = 0; i < topo_get_num_sockets(); i++)
+        xfree(sabo_topo_capacity_by_socket[i]);
+
+    xfree(sabo_topo_capacity_by_socket);
+    xfree(sabo_topo_capacity_of_socket);
+
+    sabo_topo_capacity_by_socket = NULL;
+    sabo_topo_capacity_of_socket = NULL;
+}
+
+/* Index of the first level object holding the core. Cores out of any object
+ * and objects larger than the socket get num_objs: the whole socket is a
+ * single domain at this level */
+static int topo_get_core_object(const hwloc_obj_t socket,
+                const hwloc_obj_t core,
+                const hwloc_obj_type_t type, const int num_objs)
+{
+    for (int i = 0; i < num_objs; i++) {
+        hwloc_obj_t obj;
+
+        obj = hwloc_get_obj_by_type(sabo_topology, type, (unsigned int) i);
+        assert(NULL != obj);
+
+        if (!hwloc_bitmap_isincluded(core->cpuset, obj->cpuset))
+            continue;
+
+        if (!hwloc_bitmap_isincluded(obj->cpuset, socket->cpuset))
+            return num_objs;
+
+        return i;
+    }
+
+    return num_objs;
+}
+
+static void topo_init_level(const int level)
+{
+    int *domain_ids;
+
+    const hwloc_obj_type_t type = topo_level_types[level];
+    const int num_sockets = topo_get_num_sockets();
+    const int num_objs = hwloc_get_nbobjs_by_type(sabo_topology, type);
+
+    sabo_topo_domain_id_by_socket[level] =
+        xzalloc(sizeof(int *) * (size_t) num_sockets);
+    sabo_topo_num_domains_by_socket[level] =
+        xzalloc(sizeof(int) * (size_t) num_sockets);
+
+    /* Socket domain id of each level object */
+    domain_ids = xzalloc(sizeof(int) * (size_t) (MAX(num_objs, 0) + 1));
+
+    for (int i = 0; i < num_sockets; i++) {
+        int num_domains = 0;
+        hwloc_obj_t socket;
+
+        const int num_cores = topo_get_socket_num_cores(i);
+
+        socket = hwloc_get_obj_by_type(sabo_topology, HWLOC_OBJ_PACKAGE,
+                           (unsigned int) i);
+        assert(NULL != socket);
+
+        sabo_topo_domain_id_by_socket[level][i] =
+            xzalloc(sizeof(int) * (size_t) MAX(num_cores, 1));
+
+        for (int j = 0; j <= MAX(num_objs, 0); j++)
+            domain_ids[j] = -1;
+
+        for (int j = 0; j < num_cores; j++) {
+            int obj;
+            hwloc_obj_t core;
+
+            core = hwloc_get_obj_inside_cpuset_by_type(sabo_topology,
+                                   socket->cpuset,
+                                   HWLOC_OBJ_CORE,
+                                   (unsigned int) j);
+            assert(NULL != core);
+
+            obj = topo_get_core_object(socket, core, type,
+                           MAX(num_objs, 0));
+            if (-1 == domain_ids[obj])
+                domain_ids[obj] = num_domains++;
+
+            sabo_topo_domain_id_by_socket[level][i][j] = domain_ids[obj];
+        }
+
+        sabo_topo_num_domains_by_socket[level][i] = num_domains;
+
+        debug(LOG_DEBUG_TOPO, "Detected %d domain(s) of level %d on "
+              "socket #%d", num_domains, level, i);
+    }
+
+    xfree(domain_ids);
+}
+
+static void topo_fini_levels(void)
+{
+    const int num_sockets = topo_get_num_sockets();
+
+    for (int i = 0; i < sabo_topo_depth; i++) {
+        for (int j = 0; j < num_sockets; j++)
+            xfree(sabo_topo_domain_id_by_socket[i][j]);
+
+        xfree(sabo_topo_domain_id_by_socket[i]);
+        xfree(sabo_topo_num_domains_by_socket[i]);
+
+        sabo_topo_domain_id_by_socket[i] = NULL;
+        sabo_topo_num_domains_by_socket[i] = NULL;
+    }
+
+    sabo_topo_depth = 0;
+}
+
+static void topo_fini_layout_scratch(void)
+{
+    struct topo_layout_scratch *scratch = &sabo_topo_scratch;
+
+    xfree(scratch->pack_order);
+    xfree(scratch->pack_free_cores);
+    xfree(scratch->domain_child_ids);
+    xfree(scratch->domain_children);
+    xfree(scratch->domain_sizes);
+    xfree(scratch->domain_child_cores);
+    xfree(scratch->domain_assign);
+    xfree(scratch->domain_child_pieces);
+    xfree(scratch->pieces);
+    xfree(scratch->offsets);
+    xfree(scratch->cores);
+    xfree(scratch->fit);
+    xfree(scratch->fit_ids);
+    xfree(scratch->targets);
+    xfree(scratch->target_of);
+    xfree(scratch->counts);
+    xfree(scratch->order);
+    xfree(scratch->starts);
+    xfree(scratch->sorted);
+    xfree(scratch->class_threads);
+    xfree(scratch->stable_cores);
+    xfree(scratch->assigned);
+    xfree(scratch->process_offsets);
+
+    memset(scratch, 0, sizeof(struct topo_layout_scratch));
+}
+
+static void topo_init_layout_scratch(const int max_cores,
+                     const int max_processes)
+{
+    struct topo_layout_scratch *scratch = &sabo_topo_scratch;
+
+    const size_t num_cores = (size_t) MAX(max_cores, 1);
+    const size_t num_processes = (size_t) MAX(max_processes, 1);
+    const size_t num_levels = (size_t) MAX(sabo_topo_depth, 1);
+
+    topo_fini_layout_scratch();
+
+    scratch->max_cores = (int) num_cores;
+    scratch->max_processes = (int) num_processes;
+
+    scratch->pack_order = xzalloc(sizeof(int) * num_processes);
+    scratch->pack_free_cores = xzalloc(sizeof(int) * num_cores);
+
+    scratch->domain_child_ids = xzalloc(sizeof(int) * num_levels * num_cores);
+    scratch->domain_children = xzalloc(sizeof(int) * num_levels * num_cores);
+    scratch->domain_sizes = xzalloc(sizeof(int) * num_levels * num_cores);
+    scratch->domain_child_cores =
+        xzalloc(sizeof(int) * num_levels * num_cores);
+    scratch->domain_assign =
+        xzalloc(sizeof(int) * num_levels * num_processes * num_cores);
+    scratch->domain_child_pieces =
+        xzalloc(sizeof(int) * num_levels * 2 * num_processes);
+
+    scratch->pieces = xzalloc(sizeof(int) * 2 * num_processes);
+    scratch->offsets = xzalloc(sizeof(int) * num_processes);
+    scratch->cores = xzalloc(sizeof(int) * num_cores);
+
+    scratch->fit = xzalloc(sizeof(int) * num_processes);
+    scratch->fit_ids = xzalloc(sizeof(int) * num_cores);
+
+    scratch->targets = xzalloc(sizeof(int) * num_cores);
+    scratch->target_of = xzalloc(sizeof(int) * num_cores);
+    scratch->counts = xzalloc(sizeof(int) * num_processes);
+
+    scratch->order = xzalloc(sizeof(int) * num_processes);
+    scratch->starts = xzalloc(sizeof(int) * num_processes);
+    scratch->sorted = xzalloc(sizeof(int) * num_cores);
+    scratch->class_threads = xzalloc(sizeof(int) * num_processes);
+
+    scratch->stable_cores = xzalloc(sizeof(int) * num_cores);
+    scratch->assigned = xzalloc(sizeof(int) * num_cores);
+    scratch->process_offsets = xzalloc(sizeof(int) * num_processes);
+}
+
+/* A socket holds more processes than cores when it is oversubscribed */
+static void topo_reserve_layout_scratch(const int num_processes)
+{
+    if (likely(num_processes <= sabo_topo_scratch.max_processes))
+        return;
+
+    topo_init_layout_scratch(sabo_topo_scratch.max_cores, num_processes);
+}
+
+/* Child with the fewest free cores holding num cores, -1 if none */
+static int topo_pack_best_fit(const int *num_free_cores, const int num_children,
+                  const int num)
+{
+    int best = -1;
+
+    for (int i = 0; i < num_children; i++) {
+        if (num > num_free_cores[i])
+            continue;
+
+        if (-1 == best || num_free_cores[i] < num_free_cores[best])
+            best = i;
+    }
+
+    return best;
+}
+
+/* Split the pieces of processes between the children domains, each piece
+ * being a process index followed by its num threads. Largest pieces first
+ * go to the domain they fit the best, otherwise take whole free domains and
+ * the domain their rest fits the best, and are only split between the
+ * domains with the most free cores when they fit nowhere */
+static void topo_pack_pieces(const int *pieces, const int num_pieces,
+                 const int *sizes, const int num_children,
+                 int *assign)
+{
+    int *order = sabo_topo_scratch.pack_order;
+    int *num_free_cores = sabo_topo_scratch.pack_free_cores;
+
+    for (int i = 0; i < num_children; i++)
+        num_free_cores[i] = sizes[i];
+
+    /* Stable sort by decreasing num threads */
+    for (int i = 0; i < num_pieces; i++) {
+        int j = i;
+
+        while (0 < j && pieces[order[j - 1] * 2 + 1] < pieces[i * 2 + 1]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = i;
+    }
+
+    for (int i = 0; i < num_pieces; i++) {
+        int best;
+
+        const int idx = order[i];
+        int remaining = pieces[idx * 2 + 1];
+
+        best = topo_pack_best_fit(num_free_cores, num_children, remaining);
+        if (-1 != best) {
+            assign[idx * num_children + best] += remaining;
+            num_free_cores[best] -= remaining;
+            continue;
+        }
+
+        for (int j = 0; j < num_children && 0 < remaining; j++) {
+            if (remaining < sizes[j] || num_free_cores[j] != sizes[j])
+                continue;
+
+            assign[idx * num_children + j] = sizes[j];
+            num_free_cores[j] = 0;
+            remaining -= sizes[j];
+        }
+
+        best = topo_pack_best_fit(num_free_cores, num_children, remaining);
+        if (0 < remaining && -1 != best) {
+            assign[idx * num_children + best] += remaining;
+            num_free_cores[best] -= remaining;
+            continue;
+        }
+
+        while (0 < remaining) {
+            int num;
+
+            best = 0;
+            for (int j = 1; j < num_children; j++) {
+                if (num_free_cores[j] > num_free_cores[best])
+                    best = j;
+            }
+
+            assert(0 < num_free_cores[best]);
+
+            num = MIN(remaining, num_free_cores[best]);
+            assign[idx * num_children + best] += num;
+            num_free_cores[best] -= num;
+            remaining -= num;
+        }
+    }
+}
+
+/* Place the pieces on the local cores of a domain, the leaves give local
+ * cores in pieces order */
+static void topo_layout_domain(const int socket_id, const int level,
+                   const int *cores, const int num_cores,
+                   const int *pieces, const int num_pieces,
+                   int *offsets, int *core_ids)
+{
+    int *assign;
+    int *children;
+    int *sizes;
+    int *child_ids;
+    int *child_cores;
+    int *child_pieces;
+    int num_children = 0;
+    int num_domains;
+
+    struct topo_layout_scratch *scratch = &sabo_topo_scratch;
+    const int max_cores = scratch->max_cores;
+
+    if (sabo_topo_depth == level ||
+        1 == (num_domains = topo_get_socket_num_domains(socket_id, level))) {
+        int idx = 0;
+
+        if (sabo_topo_depth != level) {
+            topo_layout_domain(socket_id, level + 1, cores, num_cores,
+                       pieces, num_pieces, offsets, core_ids);
+            return;
+        }
+
+        for (int i = 0; i < num_pieces; i++) {
+            const int process = pieces[i * 2];
+
+            for (int j = 0; j < pieces[i * 2 + 1]; j++)
+                core_ids[offsets[process]++] = cores[idx++];
+        }
+
+        return;
+    }
+
+    child_ids = &(scratch->domain_child_ids[level * max_cores]);
+    children = &(scratch->domain_children[level * max_cores]);
+    sizes = &(scratch->domain_sizes[level * max_cores]);
+    child_cores = &(scratch->domain_child_cores[level * max_cores]);
+
+    for (int i = 0; i < num_domains; i++) {
+        child_ids[i] = -1;
+        sizes[i] = 0;
+    }
+
+    /* Children domains in cores order */
+    for (int i = 0; i < num_cores; i++) {
+        const int domain_id = topo_get_socket_domain_id(socket_id, level,
+                                cores[i]);
+        if (-1 == child_ids[domain_id]) {
+            children[num_children] = domain_id;
+            child_ids[domain_id] = num_children++;
+        }
+        sizes[child_ids[domain_id]]++;
+    }
+
+    if (1 == num_children) {
+        topo_layout_domain(socket_id, level + 1, cores, num_cores,
+                   pieces, num_pieces, offsets, core_ids);
+        return;
+    }
+
+    assign = &(scratch->domain_assign[level * scratch->max_processes *
+                      max_cores]);
+    child_pieces = &(scratch->domain_child_pieces[level * 2 *
+                              scratch->max_processes]);
+
+    for (int i = 0; i < num_pieces * num_children; i++)
+        assign[i] = 0;
+
+    topo_pack_pieces(pieces, num_pieces, sizes, num_children, assign);
+
+    for (int i = 0; i < num_children; i++) {
+        int num_child_cores = 0;
+        int num_child_pieces = 0;
+
+        for (int j = 0; j < num_cores; j++) {
+            if (children[i] == topo_get_socket_domain_id(socket_id, level,
+                                     cores[j]))
+                child_cores[num_child_cores++] = cores[j];
+        }
+
+        for (int j = 0; j < num_pieces; j++) {
+            if (0 == assign[j * num_children + i])
+                continue;
+
+            child_pieces[num_child_pieces * 2] = pieces[j * 2];
+            child_pieces[num_child_pieces * 2 + 1] =
+                assign[j * num_children + i];
+            num_child_pieces++;
+        }
+
+        topo_layout_domain(socket_id, level + 1, child_cores,
+                   num_child_cores, child_pieces, num_child_pieces,
+                   offsets, core_ids);
+    }
+}
+
+/* Threads of each process fitting on num_cores cores, the largest
+ * processes give their threads first. Processes beyond the socket cores
+ * get none. Returns the fitted threads */
+static int topo_fit_num_threads(const int num_processes, const int *num_threads,
+                const int num_cores, int *fit)
+{
+    int total = 0;
+
+    for (int i = 0; i < num_processes; i++) {
+        fit[i] = num_threads[i];
+        total += num_threads[i];
+    }
+
+    while (total > num_cores) {
+        int largest = 0;
+
+        for (int i = 1; i < num_processes; i++) {
+            if (fit[i] > fit[largest])
+                largest = i;
+        }
+
+        fit[largest]--;
+        total--;
+    }
+
+    return total;
+}
+
+/* Spread the threads of each process on its fitted cores, a process
+ * without core shares the cores of the others */
+static void topo_share_cores(const int num_processes, const int *num_threads,
+                 const int *fit, const int fit_total,
+                 const int *fit_ids, int *ids)
+{
+    int shared = 0;
+
+    for (int i = 0, src = 0, dst = 0; i < num_processes; i++) {
+        for (int j = 0; j < num_threads[i]; j++) {
+            if (0 < fit[i])
+                ids[dst++] = fit_ids[src + j % fit[i]];
+            else
+                ids[dst++] = fit_ids[shared++ % fit_total];
+        }
+
+        src += fit[i];
+    }
+}
+
+/* Local cores of the processes on a subset of the socket cores, the
+ * threads fit on the cores */
+static void topo_layout_cores(const int socket_id, const int *cores,
+                  const int num_cores, const int num_processes,
+                  const int *num_threads, int *local_ids)
+{
+    int *pieces = sabo_topo_scratch.pieces;
+    int *offsets = sabo_topo_scratch.offsets;
+    int num_pieces = 0;
+    int total = 0;
+
+    for (int i = 0; i < num_processes; i++) {
+        offsets[i] = total;
+        total += num_threads[i];
+
+        if (0 == num_threads[i])
+            continue;
+
+        pieces[num_pieces * 2] = i;
+        pieces[num_pieces * 2 + 1] = num_threads[i];
+        num_pieces++;
+    }
+
+    assert(total <= num_cores);
+
+    topo_layout_domain(socket_id, 0, cores, num_cores, pieces,
+               num_pieces, offsets, local_ids);
+}
+
+/* Local cores of the processes placed on a socket, see
+ * topo_get_socket_layout */
+static void topo_layout_socket(const int socket_id, const int num_processes,
+                   const int *num_threads, int *local_ids)
+{
+    int *cores;
+    int total = 0;
+
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+
+    for (int i = 0; i < num_processes; i++)
+        total += num_threads[i];
+
+    /* Oversubscribed socket: lay out the threads fitting on the cores,
+     * the others share them */
+    if (unlikely(num_cores < total)) {
+        int *fit = sabo_topo_scratch.fit;
+        int *fit_ids = sabo_topo_scratch.fit_ids;
+        const int fit_total = topo_fit_num_threads(num_processes, num_threads,
+                               num_cores, fit);
+
+        debug(LOG_DEBUG_TOPO, "Socket #%d oversubscribed: %d thread(s) on "
+              "%d core(s)", socket_id, total, num_cores);
+
+        topo_layout_socket(socket_id, num_processes, fit, fit_ids);
+        topo_share_cores(num_processes, num_threads, fit, fit_total, fit_ids,
+                 local_ids);
+        return;
+    }
+
+    cores = sabo_topo_scratch.cores;
+
+    for (int i = 0; i < num_cores; i++)
+        cores[i] = i;
+
+    topo_layout_cores(socket_id, cores, num_cores, num_processes,
+              num_threads, local_ids);
+}
+
+/* Cores of the processes placed on a socket, in processes order: the cores
+ * of process i start after the threads of the previous processes. Each
+ * process is packed into as few NUMA nodes, then L3 caches, as possible */
+void topo_get_socket_layout(const int socket_id, const int num_processes,
+                const int *num_threads, int *core_ids)
+{
+    int total = 0;
+
+    for (int i = 0; i < num_processes; i++)
+        total += num_threads[i];
+
+    topo_reserve_layout_scratch(num_processes);
+    topo_layout_socket(socket_id, num_processes, num_threads, core_ids);
+
+    for (int i = 0; i < total; i++)
+        core_ids[i] = topo_get_socket_core_id(socket_id, core_ids[i]);
+}
+
+/* First process of a key which still needs cores, -1 if none */
+static int topo_find_process_key(const int key, const int num_processes,
+                 const int *keys, const int *num_threads,
+                 const int *counts)
+{
+    if (-1 == key)
+        return -1;
+
+    for (int i = 0; i < num_processes; i++) {
+        if (key == keys[i] && counts[i] < num_threads[i])
+            return i;
+    }
+
+    return -1;
+}
+
+/* Stable assignment of a subset of the socket local cores, see
+ * topo_get_socket_stable_layout. assigned holds the process of each local
+ * core, -1 for a free one, and is updated for the cores of the subset */
+static void topo_stable_assign(const int socket_id, const int *cores,
+                   const int num_cores, const int num_processes,
+                   const int *keys, const int *num_threads,
+                   const int *owners, int *assigned)
+{
+    int *targets = sabo_topo_scratch.targets;
+    int *target_of = sabo_topo_scratch.target_of;
+    int *counts = sabo_topo_scratch.counts;
+
+    for (int i = 0; i < num_processes; i++)
+        counts[i] = 0;
+
+    topo_layout_cores(socket_id, cores, num_cores, num_processes, num_threads,
+              targets);
+
+    for (int i = 0; i < num_cores; i++)
+        target_of[cores[i]] = -1;
+
+    for (int i = 0, idx = 0; i < num_processes; i++) {
+        for (int j = 0; j < num_threads[i]; j++)
+            target_of[targets[idx++]] = i;
+    }
+
+    /* Previous cores of the packed layout */
+    for (int i = 0; i < num_cores; i++) {
+        const int local = cores[i];
+        const int process = target_of[local];
+
+        if (-1 != process && owners[local] == keys[process]) {
+            assigned[local] = process;
+            counts[process]++;
+        }
+    }
+
+    /* Other previous cores */
+    for (int i = 0; i < num_cores; i++) {
+        int process;
+        const int local = cores[i];
+
+        if (-1 != assigned[local])
+            continue;
+
+        process = topo_find_process_key(owners[local], num_processes, keys,
+                        num_threads, counts);
+        if (-1 != process) {
+            assigned[local] = process;
+            counts[process]++;
+        }
+    }
+
+    /* Free cores of the packed layout */
+    for (int i = 0; i < num_cores; i++) {
+        const int local = cores[i];
+        const int process = target_of[local];
+
+        if (-1 == assigned[local] && -1 != process &&
+            counts[process] < num_threads[process]) {
+            assigned[local] = process;
+            counts[process]++;
+        }
+    }
+
+    /* Any free core */
+    for (int i = 0, j = 0; i < num_processes; i++) {
+        for (; counts[i] < num_threads[i] && j < num_cores; j++) {
+            if (-1 != assigned[cores[j]])
+                continue;
+
+            assigned[cores[j]] = i;
+            counts[i]++;
+        }
+    }
+}
+
+/* Every core of the socket delivers the same capacity */
+static int topo_is_socket_uniform(const int socket_id)
+{
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+    const int capacity = topo_get_socket_core_capacity(socket_id, 0);
+
+    for (int i = 1; i < num_cores; i++) {
+        if (capacity != topo_get_socket_core_capacity(socket_id, i))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Local cores of a socket by decreasing capacity, then by local id */
+void topo_get_socket_sorted_cores(const int socket_id, int *cores)
+{
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+
+    for (int i = 0; i < num_cores; i++) {
+        const int capacity = topo_get_socket_core_capacity(socket_id, i);
+        int j = i;
+
+        while (0 < j && capacity >
+               topo_get_socket_core_capacity(socket_id, cores[j - 1])) {
+            cores[j] = cores[j - 1];
+            j--;
+        }
+
+        cores[j] = i;
+    }
+}
+
+/* The processes with the highest priority take the fastest cores: the
+ * sorted cores are handed out in priorities order, then the cores of each
+ * capacity are laid out with the threads each process got there */
+static void topo_stable_assign_capacities(const int socket_id,
+                      const int num_processes,
+                      const int *keys,
+                      const int *num_threads,
+                      const int *priorities,
+                      const int *owners, int *assigned)
+{
+    int *order = sabo_topo_scratch.order;
+    int *starts = sabo_topo_scratch.starts;
+    int *sorted = sabo_topo_scratch.sorted;
+    int *class_threads = sabo_topo_scratch.class_threads;
+    int first = 0;
+
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+
+    /* Processes by decreasing priority, then in processes order */
+    for (int i = 0; i < num_processes; i++) {
+        int j = i;
+
+        while (0 < j && priorities[i] > priorities[order[j - 1]]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = i;
+    }
+
+    for (int i = 0, start = 0; i < num_processes; i++) {
+        starts[order[i]] = start;
+        start += num_threads[order[i]];
+    }
+
+    topo_get_socket_sorted_cores(socket_id, sorted);
+
+    while (first < num_cores) {
+        int last = first;
+        const int capacity = topo_get_socket_core_capacity(socket_id,
+                                   sorted[first]);
+
+        while (last < num_cores && capacity ==
+               topo_get_socket_core_capacity(socket_id, sorted[last]))
+            last++;
+
+        for (int i = 0; i < num_processes; i++) {
+            const int begin = MAX(starts[i], first);
+            const int end = MIN(starts[i] + num_threads[i], last);
+
+            class_threads[i] = MAX(end - begin, 0);
+        }
+
+        topo_stable_assign(socket_id, &(sorted[first]), last - first,
+                   num_processes, keys, class_threads, owners, assigned);
+
+        first = last;
+    }
+}
+
+/* See topo_get_socket_stable_layout, the threads fit on the socket */
+static void topo_stable_layout_socket(const int socket_id,
+                      const int num_processes, const int *keys,
+                      const int *num_threads,
+                      const int *priorities, int *owners,
+                      int *core_ids)
+{
+    int *cores = sabo_topo_scratch.stable_cores;
+    int *assigned = sabo_topo_scratch.assigned;
+    int *offsets = sabo_topo_scratch.process_offsets;
+
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+
+    for (int i = 0; i < num_cores; i++) {
+        cores[i] = i;
+        assigned[i] = -1;
+    }
+
+    if (NULL == priorities || topo_is_socket_uniform(socket_id))
+        topo_stable_assign(socket_id, cores, num_cores, num_processes, keys,
+                   num_threads, owners, assigned);
+    else
+        topo_stable_assign_capacities(socket_id, num_processes, keys,
+                          num_threads, priorities, owners,
+                          assigned);
+
+    for (int i = 0, offset = 0; i < num_processes; i++) {
+        offsets[i] = offset;
+        offset += num_threads[i];
+    }
+
+    for (int i = 0; i < num_cores; i++) {
+        const int process = assigned[i];
+
+        if (-1 == process) {
+            owners[i] = -1;
+            continue;
+        }
+
+        owners[i] = keys[process];
+        core_ids[offsets[process]++] = topo_get_socket_core_id(socket_id, i);
+    }
+}
+
+/* Socket layout moving as few cores as possible from the previous one.
+ * owners holds the key of the process of each local core, -1 for a free
+ * core, and is updated. A process keeps its previous cores up to its new
+ * threads, those of its packed layout first, then takes the free cores of
+ * its packed layout and last any free core. Cores are given in processes
+ * order as for topo_get_socket_layout. On a socket whose cores have
+ * different capacities, the processes with the highest priorities take
+ * the fastest cores (NULL priorities ignore capacities). On an
+ * oversubscribed socket the cores are owned by the fitted threads and
+ * shared by the others */
+void topo_get_socket_stable_layout(const int socket_id,
+                   const int num_processes, const int *keys,
+                   const int *num_threads, const int *priorities,
+                   int *owners, int *core_ids)
+{
+    int total = 0;
+    int fit_total;
+    int *fit;
+    int *fit_ids;
+
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+
+    for (int i = 0; i < num_processes; i++)
+        total += num_threads[i];
+
+    topo_reserve_layout_scratch(num_processes);
+
+    if (likely(total <= num_cores)) {
+        topo_stable_layout_socket(socket_id, num_processes, keys,
+                      num_threads, priorities, owners, core_ids);
+        return;
+    }
+
+    fit = sabo_topo_scratch.fit;
+    fit_ids = sabo_topo_scratch.fit_ids;
+    fit_total = topo_fit_num_threads(num_processes, num_threads, num_cores,
+                     fit);
+
+    topo_stable_layout_socket(socket_id, num_processes, keys, fit,
+                  priorities, owners, fit_ids);
+    topo_share_cores(num_processes, num_threads, fit, fit_total, fit_ids,
+             core_ids);
+}
+
+int topo_get_thread_cpubind(void)
+{
+    int rc;
+    int core_id;
+    int num_cores;
+    hwloc_cpuset_t cpuset;
+
+    cpuset = hwloc_bitmap_alloc();
+    rc = hwloc_get_cpubind(sabo_topology, cpuset,
+                   HWLOC_CPUBIND_THREAD);
+    if (unlikely(0 != rc))
+        fatal_error("Unexpected error on hwloc_get_cpubind");
+
+    num_cores = hwloc_get_nbobjs_inside_cpuset_by_type(sabo_topology,
+                               cpuset,
+                               HWLOC_OBJ_CORE);
+    /* No real binding */
+    if (num_cores > 1)
+        return -1;
+
+    hwloc_bitmap_singlify(cpuset);
+    core_id = hwloc_bitmap_first(cpuset);
+
+    hwloc_bitmap_free(cpuset);
+
+    return core_id;
+}
+
+/* Keep the cpus the job may use: the allowed cpuset of the node, i.e. the
+ * cgroup of the job, minus the cores holding a reserved cpu */
+static void topo_restrict_usable_cores(void)
+{
+    hwloc_bitmap_t cpuset;
+    hwloc_bitmap_t reserved;
+    char string[PATH_MAX];
+
+    cpuset = hwloc_bitmap_dup(hwloc_topology_get_allowed_cpuset(sabo_topology));
+    reserved = hwloc_bitmap_alloc();
+
+    if (!env_get_reserved_cores(string, PATH_MAX) &&
+        0 > hwloc_bitmap_list_sscanf(reserved, string)) {
+        error("Invalid reserved cores '%s'", string);
+        hwloc_bitmap_zero(reserved);
+    }
+
+    for (int i = hwloc_bitmap_first(reserved); -1 != i;
+         i = hwloc_bitmap_next(reserved, i)) {
+        hwloc_obj_t core;
+
+        core = hwloc_get_pu_obj_by_os_index(sabo_topology, (unsigned int) i);
+        if (NULL == core)
+            continue;
+
+        /* Reserved cpus remove their whole core */
+        core = hwloc_get_ancestor_obj_by_type(sabo_topology, HWLOC_OBJ_CORE,
+                              core);
+        if (NULL != core)
+            hwloc_bitmap_andnot(cpuset, cpuset, core->cpuset);
+        else
+            hwloc_bitmap_clr(cpuset, (unsigned int) i);
+    }
+
+    if (hwloc_bitmap_iszero(cpuset)) {
+        error("No usable core left, keep the whole topology");
+    } else if (!hwloc_bitmap_isequal(cpuset,
+                     hwloc_topology_get_topology_cpuset(sabo_topology))) {
+        if (0 != hwloc_topology_restrict(sabo_topology, cpuset, 0))
+            error("Unexpected error on hwloc_topology_restrict");
+    }
+
+    (void) hwloc_bitmap_list_snprintf(string, PATH_MAX, cpuset);
+    debug(LOG_DEBUG_TOPO, "Usable cpus '%s'", string);
+
+    hwloc_bitmap_free(reserved);
+    hwloc_bitmap_free(cpuset);
+}
+
+/* Topology cache of the node, keyed by hostname and boot id */
+static int topo_get_cache_filename(char *filename, size_t size)
+{
+    int ret;
+    FILE *file;
+    char dirname[PATH_MAX];
+    char hostname[256];
+    char boot_id[64];
+
+    if (env_get_topo_cache_dir(dirname, PATH_MAX))
+        return -1;
+
+    if (0 != gethostname(hostname, sizeof(hostname)))
+        return -1;
+    hostname[sizeof(hostname) - 1] = '\0';
+
+    boot_id[0] = '\0';
+    if (NULL != (file = fopen("/proc/sys/kernel/random/boot_id", "r"))) {
+        if (1 != fscanf(file, "%63s", boot_id))
+            boot_id[0] = '\0';
+        fclose(file);
+    }
+
+    ret = snprintf(filename, size, "%s/sabo-topo-%s-%s-%x.xml", dirname,
+               hostname, boot_id, (unsigned int) HWLOC_API_VERSION);
+
+    return (0 > ret || size <= (size_t) ret) ? -1 : 0;
+}
+
+/* The whole machine is loaded and cached, each process then restricts it to
+ * the resources it is allowed to use */
+static int topo_load_system(const char *filename)
+{
+    int ret;
+    char tmpname[PATH_MAX];
+
+    hwloc_topology_set_flags(sabo_topology,
+                 HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED);
+
+    if (0 != hwloc_topology_load(sabo_topology))
+        return -1;
+
+    ret = snprintf(tmpname, PATH_MAX, "%s.%d", filename, (int) getpid());
+    if (0 > ret || PATH_MAX <= ret)
+        return 0;
+
+    /* Concurrent writers are fine, readers only see complete files */
+    if (0 != hwloc_topology_export_xml(sabo_topology, tmpname, 0) ||
+        0 != rename(tmpname, filename)) {
+        error("Cannot write topology cache '%s'", filename);
+        (void) unlink(tmpname);
+    }
+
+    return 0;
+}
+
+static int topo_load_cache(const char *filename)
+{
+    int elapsed = 0;
+
+    /* Other node local ranks leave the load to the first one */
+    if (0 < env_get_node_task_id()) {
+        while (0 != access(filename, R_OK) &&
+               TOPO_CACHE_TIMEOUT_USEC > elapsed) {
+            usleep(TOPO_CACHE_WAIT_USEC);
+            elapsed += TOPO_CACHE_WAIT_USEC;
+        }
+    }
+
+    if (0 != access(filename, R_OK))
+        return -1;
+
+    hwloc_topology_set_xml(sabo_topology, filename);
+    hwloc_topology_set_flags(sabo_topology,
+                 HWLOC_TOPOLOGY_FLAG_INCLUDE_DISALLOWED |
+                 HWLOC_TOPOLOGY_FLAG_IS_THISSYSTEM |
+                 HWLOC_TOPOLOGY_FLAG_THISSYSTEM_ALLOWED_RESOURCES);
+
+    if (0 == hwloc_topology_load(sabo_topology))
+        return 0;
+
+    /* Unreadable cache, start again from the system */
+    hwloc_topology_destroy(sabo_topology);
+    hwloc_topology_init(&sabo_topology);
+
+    return -1;
+}
+
+static void topo_load(void)
+{
+    int cached = 0;
+    char filename[PATH_MAX];
+
+    const double start = sabo_omp_get_wtime();
+
+    hwloc_topology_init(&sabo_topology);
+
+    if (!env_get_hwloc_xml_file(filename, PATH_MAX)) {
+        hwloc_topology_set_xml(sabo_topology, filename);
+        hwloc_topology_load(sabo_topology);
+    } else if (topo_get_cache_filename(filename, PATH_MAX)) {
+        hwloc_topology_load(sabo_topology);
+    } else if (!(cached = !topo_load_cache(filename)) &&
+           0 != topo_load_system(filename)) {
+        fatal_error("Cannot load the topology");
+    }
+
+    debug(LOG_DEBUG_PERF, "Load topology in %.3f usec(s)%s",
+          (sabo_omp_get_wtime() - start) * 1000000,
+          (cached) ? " from cache" : "");
+}
+
+void topo_init(void)
+{
+    int num_cores;
+    int num_cores_per_socket;
+    int num_sockets;
+
+    topo_load();
+
+    topo_restrict_usable_cores();
+
+    num_cores = topo_get_num_cores();
+    if (0 > num_cores)
+        fatal_error("Unexpected num cores (%d)", num_cores);
+
+    num_sockets = topo_get_num_sockets();
+    if (1 > num_sockets)
+        error("sabo need at least one socket (%d)", num_sockets);
+
+    num_cores_per_socket = topo_get_num_cores_per_socket();
+    for (int i = 0; i < num_sockets; i++) {
+        const int num_socket_cores = topo_get_socket_num_cores(i);
+
+        if (2 > num_socket_cores)
+            error("sabo need at least two cores per socket (%d on socket "
+                  "#%d)", num_socket_cores, i);
+    }
+
+    /* initialiaze array in sequential part */
+    topo_get_socket_core_id(0,0);
+    topo_init_core_cpusets();
+
+    if (1 > num_sockets || 1 > num_cores_per_socket)
+        return;
+
+    topo_init_capacities();
+    topo_init_distances();
+
+    sabo_topo_depth = MIN(env_get_topo_depth(), TOPO_NUM_LEVELS);
+    for (int i = 0; i < sabo_topo_depth; i++)
+        topo_init_level(i);
+
+    topo_init_layout_scratch(num_cores_per_socket, num_cores_per_socket);
+}
+
+void topo_fini(void)
+{
+    if (unlikely(NULL == sabo_topology))
+        fatal_error("No hwloc topology init");
+
+    topo_fini_layout_scratch();
+    topo_fini_levels();
+    topo_fini_capacities();
+    topo_fini_distances();
+    topo_fini_core_cpusets();
+    topo_fini_core_ids();
+
+    xfree(sabo_topo_num_cores_by_socket);
+    sabo_topo_num_cores_by_socket = NULL;
 
     hwloc_topology_destroy(sabo_topology);
     sabo_topology = NULL;
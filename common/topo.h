@@ -5,18 +5,72 @@
 #ifndef  __include_topo_h__
 #define  __include_topo_h__
 
+#include <sched.h>
+
 #include "hwloc.h"
 
+/* Capacity of the fastest cores of the node */
+#define TOPO_CAPACITY_SCALE 1024
+
+/* Memory distance between sockets relative to a local access, as in the
+ * ACPI SLIT */
+#define TOPO_DISTANCE_LOCAL 10
+#define TOPO_DISTANCE_REMOTE 20
+
+/* Use of the hardware threads of a core: one thread per core, threads on
+ * every hardware thread, or hardware threads for the lightest ranks */
+enum topo_smt_policy {
+    TOPO_SMT_OFF = 0,
+    TOPO_SMT_FILL,
+    TOPO_SMT_RANK,
+    TOPO_NUM_SMT_POLICIES
+};
+
+/* Hierarchy levels below the socket used to pack the threads of a process */
+enum topo_level {
+    TOPO_LEVEL_NUMA = 0,
+    TOPO_LEVEL_L3,
+    TOPO_NUM_LEVELS
+};
+
 void topo_init(void);
 void topo_fini(void);
 
 int topo_get_num_sockets(void);
 int topo_get_num_cores(void);
 int topo_get_num_cores_per_socket(void);
+int topo_get_socket_num_cores(const int socket_id);
+int topo_get_num_usable_cores(void);
+
+int topo_get_socket_core_capacity(const int socket_id, const int local_core_id);
+int topo_get_socket_capacity(const int socket_id);
+int topo_get_socket_distance(const int socket_id, const int other_id);
 
 int topo_get_socket_core_id(int socket_id, int local_core_id);
 int topo_get_socket_id_from_core_id(const int core_id);
 
+int topo_get_depth(void);
+int topo_get_socket_num_domains(const int socket_id, const int level);
+int topo_get_socket_domain_id(const int socket_id, const int level,
+                  const int local_core_id);
+void topo_get_socket_layout(const int socket_id, const int num_processes,
+                const int *num_threads, int *core_ids);
+void topo_get_socket_stable_layout(const int socket_id,
+                   const int num_processes, const int *keys,
+                   const int *num_threads, const int *priorities,
+                   int *owners, int *core_ids);
+void topo_get_socket_sorted_cores(const int socket_id, int *cores);
+
+/* Binding masks of a cpu, NULL if it is not a cpu of a usable core */
+hwloc_const_cpuset_t topo_get_core_cpuset(const int core_id);
+const cpu_set_t *topo_get_core_mask(const int core_id);
+
+/* Hardware threads of the usable cores */
+enum topo_smt_policy topo_get_smt_policy(void);
+int topo_get_num_smt(void);
+int topo_get_core_num_pus(const int core_id);
+int topo_get_core_pu_id(const int core_id, const int idx);
+
 int topo_get_thread_cpubind(void);
 hwloc_topology_t topo_get_hwloc_topology(void);
 
@@ -16,6 +16,7 @@
 #include "env.h"
 #include "list.h"
 #include "log.h"
+#include "memory.h"
 #include "sys.h"
 #include "topo.h"
 
@@ -30,32 +31,99 @@
 
 #define SABO_REBALANCING_THRESHOLD ((double) 0.1)
 
+/* Cost of a socket change to the closest socket, farther sockets cost
+ * proportionally to their memory distance */
+#define SABO_MOVE_COST_SCALE 4
+
 struct core_socket_data {
+    int num_cores;
+    /* Socket capacity counted in cores of the fastest kind */
+    int num_weighted_cores;
     int num_processes;
     int num_free_cores;
     core_process_t **processes;
+    /* Node rank owning each local core, -1 for a free core. Every rank
+     * updates the owners of every socket to keep them identical */
+    int *core_owners;
+    /* Capacity of the socket cores, fastest first */
+    int *capacities;
 };
 typedef struct core_socket_data core_socket_data_t;
 
 struct core_ctx {
     int num_sockets;
+    /* Cores of the largest socket, the most threads of a process */
     int num_cores_per_socket;
     int node_rank;
     int node_comm_size;
     int num_cores;
+    /* Omp threads of a process using every hardware thread of the node */
+    int max_num_threads;
     int init_once;
 
+    /* Capacity weighted cores of the node and of the largest socket, the
+     * threads distribution is computed in these units */
+    int num_weighted_cores;
+    int max_weighted_cores;
+
+    /* Most weighted cores of a process, a socket unless a process may span
+     * several sockets */
+    int spanning;
+    int max_process_cores;
+
+    /* Per socket parts of the processes placed by the solver, the part of
+     * process i is the i-th one and the extra parts of the processes
+     * larger than a socket follow */
+    int num_parts;
+    int max_num_parts;
+    core_process_t *parts;
+
+    /* Socket weighted cores by decreasing order to split processes */
+    int *sorted_weighted_cores;
+
     int implicit_balancing;
+    /* Set while the process computes its placement, the parallel regions
+     * of sabo itself are not application regions */
+    int balancing;
+    /* Omp threads rebind themselves at their next implicit task instead of
+     * in an extra parallel region */
+    int lazy_binding;
     int window;
     int step;
 
     double cumulate_elapsed;
     double mpi_elapsed;
 
+    /* Private memory of the process follows its sockets, a migration
+     * larger than the step limit goes on at the next steps */
+    int memory_follow;
+    int memory_pending;
+    size_t memory_max_size;
+    int *memory_sockets;
+    int *memory_socket_ids;
+    struct memory_follow follow;
+
     core_process_t *myprocess;
     core_process_t *processes;
 
     core_socket_data_t *data;
+
+    /* Socket layout scratch arrays */
+    int *layout_num_threads;
+    int *layout_keys;
+    int *layout_priorities;
+    int *layout_core_ids;
+
+    /* Hardware threads of the process cores and the ones already taken by
+     * an omp thread */
+    int *pu_ids;
+    int *pu_used;
+
+    /* Omp threads kept on (clean) or moved to another (dirty) hardware
+     * thread by the rebalances */
+    int num_rebalances;
+    int num_clean_threads;
+    int num_dirty_threads;
 };
 
 static struct core_ctx *__sabo_core_ctx = NULL;
@@ -76,7 +144,7 @@ static void sabo_core_init_process(core_process_t *process)
 {
     void *ptr;
     const int window = __sabo_core_ctx->window;
-    const int num_cores = __sabo_core_ctx->num_cores;
+    const int max_num_threads = __sabo_core_ctx->max_num_threads;
 
     /* MPI comm ranks */
     process->node_rank = -1;
@@ -90,8 +158,12 @@ static void sabo_core_init_process(core_process_t *process)
     process->prev_num_threads = -1;
     process->prev_socket_id = -1;
 
-    ptr = xzalloc(sizeof(double) * (size_t) num_cores);
+    process->num_pus_per_core = 1;
+    process->num_omp_threads = -1;
+
+    ptr = xzalloc(sizeof(double) * (size_t) max_num_threads);
     process->ompt.elapsed = (double *) ptr;
+    process->ompt.num_threads = max_num_threads;
 
     process->counters.delta = xzalloc(sizeof(double) * (size_t) window);
     process->counters.num_threads = xzalloc(sizeof(int) * (size_t) window);
@@ -127,20 +199,98 @@ static void core_discover_placement(core_process_t *process)
 #else
     process->socket_id = -1;
     process->num_threads = env_get_omp_num_threads();
+    process->num_omp_threads = process->num_threads;
 #endif
 }
 
+/* Socket capacity in cores of the fastest kind, at least one core */
+static int core_compute_weighted_cores(const int socket_id)
+{
+    const int capacity = topo_get_socket_capacity(socket_id);
+    const int num_cores = topo_get_socket_num_cores(socket_id);
+    int num_weighted_cores;
+
+    num_weighted_cores = (capacity + TOPO_CAPACITY_SCALE / 2) /
+        TOPO_CAPACITY_SCALE;
+
+    return MIN(MAX(num_weighted_cores, 1), num_cores);
+}
+
+static int core_cmp_ints_decreasing(void const *ptr1, void const *ptr2)
+{
+    return *((int const *) ptr2) - *((int const *) ptr1);
+}
+
+/* Moving a process far from the socket holding its memory costs more */
+static void core_set_socket_move_costs(void)
+{
+    int *costs;
+    int min_distance = INT_MAX;
+
+    const int num_sockets = __sabo_core_ctx->num_sockets;
+
+    for (int i = 0; i < num_sockets; i++) {
+        for (int j = 0; j < num_sockets; j++) {
+            if (i != j)
+                min_distance = MIN(min_distance,
+                           topo_get_socket_distance(i, j));
+        }
+    }
+
+    if (INT_MAX == min_distance)
+        return; /* single socket */
+
+    costs = xzalloc(sizeof(int) * (size_t) (num_sockets * num_sockets));
+
+    for (int i = 0; i < num_sockets; i++) {
+        for (int j = 0; j < num_sockets; j++) {
+            const int distance = topo_get_socket_distance(i, j);
+
+            if (i == j)
+                continue;
+
+            costs[i * num_sockets + j] = (distance * SABO_MOVE_COST_SCALE +
+                              min_distance / 2) / min_distance;
+        }
+    }
+
+    decision_tree_set_socket_move_costs(costs);
+    xfree(costs);
+}
+
+/* Decision tree sized once for the most parts, the number of parts to
+ * place changes when a process starts or stops spanning sockets without
+ * losing the solver state */
+static void core_init_decision_tree(void)
+{
+    int *socket_num_cores;
+
+    const int num_sockets = __sabo_core_ctx->num_sockets;
+
+    decision_tree_init(num_sockets, __sabo_core_ctx->num_cores_per_socket,
+               __sabo_core_ctx->max_num_parts);
+
+    socket_num_cores = xzalloc(sizeof(int) * (size_t) num_sockets);
+    for (int i = 0; i < num_sockets; i++)
+        socket_num_cores[i] = __sabo_core_ctx->data[i].num_weighted_cores;
+    decision_tree_set_socket_num_cores(socket_num_cores);
+    xfree(socket_num_cores);
+
+    core_set_socket_move_costs();
+}
+
 /* Core processes allocations */
 static void core_init_context(void)
 {
     void *ptr;
+    int max_num_parts;
     core_process_t *tmp;
     core_process_t *myprocess;
 
     if (likely(__sabo_core_ctx->init_once))
         return;
 
-    const int num_cores = __sabo_core_ctx->num_cores;
+    const int max_num_threads = __sabo_core_ctx->max_num_threads;
     const int num_sockets = __sabo_core_ctx->num_sockets;
     const int num_cores_per_socket = __sabo_core_ctx->num_cores_per_socket;
 
@@ -178,9 +328,10 @@ static void core_init_context(void)
     xfree(tmp);
     __sabo_core_ctx->myprocess = myprocess;
 
-    myprocess->binding = xzalloc(sizeof(struct sys_bind_data) * (size_t) num_cores);
+    myprocess->binding = xzalloc(sizeof(struct sys_bind_data) *
+                     (size_t) max_num_threads);
 
-    for (int i = 0; i < num_cores; i++) {
+    for (int i = 0; i < max_num_threads; i++) {
          myprocess->binding[i].cur_core_id = -1;
     }
 
@@ -191,10 +342,76 @@ static void core_init_context(void)
     for (int i = 0; i < num_sockets; i++) {
         ptr =  xzalloc(sizeof(core_process_t *) * (size_t) node_comm_size);
         __sabo_core_ctx->data[i].processes = (core_process_t **) ptr;
+        __sabo_core_ctx->data[i].num_cores = topo_get_socket_num_cores(i);
+        __sabo_core_ctx->data[i].num_weighted_cores =
+            core_compute_weighted_cores(i);
+
+        ptr = xzalloc(sizeof(int) *
+                  (size_t) MAX(__sabo_core_ctx->data[i].num_cores, 1));
+        __sabo_core_ctx->data[i].core_owners = (int *) ptr;
+        for (int j = 0; j < __sabo_core_ctx->data[i].num_cores; j++)
+            __sabo_core_ctx->data[i].core_owners[j] = -1;
+
+        ptr = xzalloc(sizeof(int) *
+                  (size_t) MAX(__sabo_core_ctx->data[i].num_cores, 1));
+        __sabo_core_ctx->data[i].capacities = (int *) ptr;
+        topo_get_socket_sorted_cores(i, __sabo_core_ctx->data[i].capacities);
+        for (int j = 0; j < __sabo_core_ctx->data[i].num_cores; j++)
+            __sabo_core_ctx->data[i].capacities[j] =
+                topo_get_socket_core_capacity(i,
+                    __sabo_core_ctx->data[i].capacities[j]);
     }
 
+    ptr = xzalloc(sizeof(int) * (size_t) node_comm_size);
+    __sabo_core_ctx->layout_num_threads = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) node_comm_size);
+    __sabo_core_ctx->layout_keys = (int *) ptr;
+
+    ptr = xzalloc(sizeof(int) * (size_t) node_comm_size);
+    __sabo_core_ctx->layout_priorities = (int *) ptr;
+
+    /* A socket with more processes than cores holds a thread per process */
+    ptr = xzalloc(sizeof(int) * (size_t) MAX(num_cores_per_socket,
+                         node_comm_size));
+    __sabo_core_ctx->layout_core_ids = (int *) ptr;
+
+    __sabo_core_ctx->pu_ids = xzalloc(sizeof(int) * (size_t) max_num_threads);
+    __sabo_core_ctx->pu_used = xzalloc(sizeof(int) *
+                       (size_t) max_num_threads);
+
+    /* A spanning process has at most one part per socket */
+    max_num_parts = node_comm_size;
+    if (__sabo_core_ctx->spanning)
+        max_num_parts += num_sockets - 1;
+
+    ptr = xzalloc(sizeof(core_process_t) * (size_t) max_num_parts);
+    __sabo_core_ctx->parts = (core_process_t *) ptr;
+
+    for (int i = 0; i < max_num_parts; i++) {
+        core_process_t *part = &(__sabo_core_ctx->parts[i]);
+
+        part->node_rank = (i < node_comm_size) ? i : -1;
+        part->world_rank = (i < node_comm_size) ?
+            __sabo_core_ctx->processes[i].world_rank : -1;
+        part->socket_id = -1;
+        part->prev_socket_id = -1;
+    }
+    __sabo_core_ctx->num_parts = node_comm_size;
+    __sabo_core_ctx->max_num_parts = max_num_parts;
+
+    ptr = xzalloc(sizeof(int) * (size_t) num_sockets);
+    __sabo_core_ctx->sorted_weighted_cores = (int *) ptr;
+
+    for (int i = 0; i < num_sockets; i++)
+        __sabo_core_ctx->sorted_weighted_cores[i] =
+            __sabo_core_ctx->data[i].num_weighted_cores;
+    qsort(__sabo_core_ctx->sorted_weighted_cores, (size_t) num_sockets,
+          sizeof(int), core_cmp_ints_decreasing);
+
     /* Initialize decision tree */
-    decision_tree_init(num_sockets, num_cores_per_socket, node_comm_size);
+    core_init_decision_tree();
+    decision_tree_set_num_processes(node_comm_size);
 
     core_discover_placement(myprocess);
 
@@ -208,11 +425,25 @@ static void core_fini_context(void)
 
     /* clean sockets */
     if (NULL != __sabo_core_ctx->data) {
-        for (int i = 0; i < __sabo_core_ctx->num_sockets; i++)
+        for (int i = 0; i < __sabo_core_ctx->num_sockets; i++) {
             xfree(__sabo_core_ctx->data[i].processes);
+            xfree(__sabo_core_ctx->data[i].core_owners);
+            xfree(__sabo_core_ctx->data[i].capacities);
+        }
         xfree(__sabo_core_ctx->data);
     }
 
+    xfree(__sabo_core_ctx->layout_num_threads);
+    xfree(__sabo_core_ctx->layout_keys);
+    xfree(__sabo_core_ctx->layout_priorities);
+    xfree(__sabo_core_ctx->layout_core_ids);
+    xfree(__sabo_core_ctx->pu_ids);
+    xfree(__sabo_core_ctx->pu_used);
+    xfree(__sabo_core_ctx->parts);
+    xfree(__sabo_core_ctx->sorted_weighted_cores);
+    xfree(__sabo_core_ctx->memory_sockets);
+    xfree(__sabo_core_ctx->memory_socket_ids);
+
     /* Clean processes */
     if (NULL != __sabo_core_ctx->processes) {
         for (int i = 0; i < __sabo_core_ctx->node_comm_size; i++)
@@ -227,20 +458,146 @@ static void core_fini_context(void)
     __sabo_core_ctx = NULL;
 }
 
+static double core_compute_window_elapsed(const core_process_t *process)
+{
+    double elapsed = (double) 0;
+
+    for (int i = 0; i < __sabo_core_ctx->window; i++)
+        elapsed += process->counters.elapsed[i];
+
+    return elapsed;
+}
+
+/* Hardware threads a process runs on each of its cores. With the rank
+ * policy the processes lighter than the node average share their cores
+ * with sibling threads, every rank takes the same decision */
+static int core_compute_num_pus_per_core(const core_process_t *process,
+                     const double mean_elapsed)
+{
+    const int num_smt = topo_get_num_smt();
+
+    switch (topo_get_smt_policy()) {
+    case TOPO_SMT_FILL:
+        return num_smt;
+    case TOPO_SMT_RANK:
+        if (core_compute_window_elapsed(process) < mean_elapsed)
+            return num_smt;
+        break;
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+/* Hardware threads per core of every process, chosen before the threads
+ * distribution so that the cores freed by the light processes go to the
+ * loaded ones */
+static void core_compute_processes_pus_per_core(void)
+{
+    double mean_elapsed = (double) 0;
+
+    const int node_comm_size = __sabo_core_ctx->node_comm_size;
+
+    for (int i = 0; i < node_comm_size; i++) {
+        core_process_t *process = &(__sabo_core_ctx->processes[i]);
+        mean_elapsed += core_compute_window_elapsed(process);
+    }
+    mean_elapsed /= (double) node_comm_size;
+
+    for (int i = 0; i < node_comm_size; i++) {
+        core_process_t *process = &(__sabo_core_ctx->processes[i]);
+        process->num_pus_per_core = core_compute_num_pus_per_core(process,
+                                      mean_elapsed);
+    }
+}
+
 static void core_prepare_processes(void)
 {
     for (int i = 0; i < __sabo_core_ctx->node_comm_size; i++) {
         core_process_t *process = &(__sabo_core_ctx->processes[i]);
+
         process->prev_num_threads = process->num_threads;
         process->num_threads = process->counters.num_threads[0];
     }
 }
 
+/* Part idx of a process, the previous socket of a part only matters for
+ * the same process */
+static core_process_t *core_get_process_part(const core_process_t *process,
+                         const int idx)
+{
+    core_process_t *part = &(__sabo_core_ctx->parts[idx]);
+
+    if (part->node_rank != process->node_rank) {
+        part->node_rank = process->node_rank;
+        part->world_rank = process->world_rank;
+        part->socket_id = -1;
+        part->prev_socket_id = -1;
+    }
+
+    return part;
+}
+
+/* Processes larger than a socket take whole sockets by decreasing weighted
+ * cores then the remainder, the fewest sockets are shared with other
+ * processes. The solver chooses the socket of each part */
+static void core_split_processes(void)
+{
+    const int num_sockets = __sabo_core_ctx->num_sockets;
+    const int node_comm_size = __sabo_core_ctx->node_comm_size;
+    const int *sorted_weighted_cores = __sabo_core_ctx->sorted_weighted_cores;
+    int num_parts = node_comm_size;
+
+    for (int i = 0; i < node_comm_size; i++) {
+        const core_process_t *process = &(__sabo_core_ctx->processes[i]);
+        core_process_t *part = core_get_process_part(process, i);
+        int remaining = process->num_threads;
+
+        for (int j = 0; j < num_sockets - 1 &&
+             remaining > sorted_weighted_cores[j]; j++) {
+            part->num_threads = sorted_weighted_cores[j];
+            remaining -= sorted_weighted_cores[j];
+
+            part = core_get_process_part(process, num_parts++);
+        }
+
+        part->num_threads = remaining;
+    }
+
+    __sabo_core_ctx->num_parts = num_parts;
+
+    decision_tree_set_num_processes(num_parts);
+}
+
+/* Threads of each process summed over its parts */
+static void core_gather_processes_parts(void)
+{
+    for (int i = 0; i < __sabo_core_ctx->node_comm_size; i++) {
+        core_process_t *process = &(__sabo_core_ctx->processes[i]);
+
+        process->prev_socket_id = process->socket_id;
+        process->socket_id = __sabo_core_ctx->parts[i].socket_id;
+        process->num_threads = 0;
+    }
+
+    for (int i = 0; i < __sabo_core_ctx->num_parts; i++) {
+        const core_process_t *part = &(__sabo_core_ctx->parts[i]);
+        __sabo_core_ctx->processes[part->node_rank].num_threads +=
+            part->num_threads;
+    }
+}
+
+/* Parts of a same process keep their parts order */
 static int core_cmp_processes_by_rank(void const *ptr1, void const *ptr2)
 {
     core_process_t const *p1 = * (core_process_t * const *) ptr1;
     core_process_t const *p2 = * (core_process_t * const *) ptr2;
-    return p1->node_rank - p2->node_rank;
+
+    if (p1->node_rank != p2->node_rank)
+        return p1->node_rank - p2->node_rank;
+
+    return (p1 > p2) - (p1 < p2);
 }
 
 static void core_sort_processes_by_rank(core_socket_data_t *data)
@@ -268,32 +625,82 @@ static void core_sort_processes_by_num_threads(core_socket_data_t *data)
           sizeof(core_process_t *), core_cmp_processes_by_num_threads);
 }
 
+/* Loaded parts first, then parts by rank as in the socket layout */
+static int core_cmp_processes_by_weighted_threads(void const *ptr1,
+                          void const *ptr2)
+{
+    int diff;
+
+    core_process_t const *p1 = * (core_process_t * const *) ptr1;
+    core_process_t const *p2 = * (core_process_t * const *) ptr2;
+
+    if (0 != (diff = (p2->num_weighted_threads - p1->num_weighted_threads)))
+        return diff;
+
+    return core_cmp_processes_by_rank(ptr1, ptr2);
+}
+
+/* Threads on the socket cores delivering the capacity of the weighted
+ * cores of each part. The loaded parts take the fastest cores and the
+ * layout gives them these cores, the light parts get more slow cores */
+static void core_compute_socket_num_threads(core_socket_data_t *data)
+{
+    int next = 0;
+
+    qsort(data->processes, (size_t) data->num_processes,
+          sizeof(core_process_t *), core_cmp_processes_by_weighted_threads);
+
+    data->num_free_cores = data->num_cores;
+
+    for (int i = 0; i < data->num_processes; i++) {
+        core_process_t *process = data->processes[i];
+        const int target = process->num_weighted_threads *
+            TOPO_CAPACITY_SCALE;
+        int capacity = 0;
+        int num_threads = 0;
+
+        /* Take a core while it brings the capacity closer to the target */
+        while (next < data->num_cores &&
+               2 * capacity + data->capacities[next] < 2 * target) {
+            capacity += data->capacities[next++];
+            num_threads++;
+        }
+
+        process->num_threads = MAX(num_threads, 1);
+        data->num_free_cores -= process->num_threads;
+    }
+}
+
 static void core_dispatch_processes(void)
 {
     /* Reset socket data */
     for (int i = 0; i < __sabo_core_ctx->num_sockets; i++) {
         core_socket_data_t *data = &(__sabo_core_ctx->data[i]);
-        data->num_free_cores = __sabo_core_ctx->num_cores_per_socket;
+        data->num_free_cores = data->num_cores;
         data->num_processes = 0;
     }
 
-    /* Add process in right socket processes list */
-    for (int i = 0; i < __sabo_core_ctx->node_comm_size; i++) {
+    /* Add process parts in right socket processes list */
+    for (int i = 0; i < __sabo_core_ctx->num_parts; i++) {
         core_socket_data_t *data;
-        core_process_t *process = &(__sabo_core_ctx->processes[i]);
+        core_process_t *process = &(__sabo_core_ctx->parts[i]);
 
         assert(process->socket_id >= 0);
         assert(process->socket_id < __sabo_core_ctx->num_sockets);
 
         data = &(__sabo_core_ctx->data[process->socket_id]);
-        data->num_free_cores -= process->num_threads;
+        process->num_weighted_threads = process->num_threads;
         data->processes[data->num_processes] = process;
         data->num_processes++;
     }
 
     /* Sort socket processes array */
-    for (int i = 0; i < __sabo_core_ctx->num_sockets; i++)
-        core_sort_processes_by_num_threads(&(__sabo_core_ctx->data[i]));
+    for (int i = 0; i < __sabo_core_ctx->num_sockets; i++) {
+        core_socket_data_t *data = &(__sabo_core_ctx->data[i]);
+
+        core_compute_socket_num_threads(data);
+        core_sort_processes_by_num_threads(data);
+    }
 }
 
 static int core_skip_compute(const int step)
@@ -430,7 +837,7 @@ static int core_update_step_process_counters(core_process_t *process,
 
     /* get the number of cores required by this process */
     tmp = process->counters.elapsed[step];
-    tmp = (tmp / sum) * ((double) __sabo_core_ctx->num_cores);
+    tmp = (tmp / sum) * ((double) __sabo_core_ctx->num_weighted_cores);
     num_threads = (int) floor(tmp);
 
     /* keep the remainder of tmp that could not be allocated */
@@ -442,9 +849,9 @@ static int core_update_step_process_counters(core_process_t *process,
         delta = (double) 0;
     }
 
-    /* Process is assigned on an uniq socket */
-    if (unlikely(__sabo_core_ctx->num_cores_per_socket < num_threads)) {
-        num_threads = __sabo_core_ctx->num_cores_per_socket;
+    /* Process is assigned on an uniq socket unless it may span sockets */
+    if (unlikely(__sabo_core_ctx->max_process_cores < num_threads)) {
+        num_threads = __sabo_core_ctx->max_process_cores;
         delta = (double) -1;
     }
 
@@ -481,13 +888,17 @@ static void core_dispatch_unused_cores(const int remaining, const int step)
 
         process    = sabo_search_step_max_delta(step);
 
+        /* No process may take one more core */
+        if (unlikely(0 > process->counters.delta[step]))
+            break;
+
         /* give him one more thread */
         num_threads = process->counters.num_threads[step] + 1;
-        assert(num_threads <= __sabo_core_ctx->num_cores_per_socket);
+        assert(num_threads <= __sabo_core_ctx->max_process_cores);
 
         process->counters.delta[step] = (double) 0;
 
-        if (unlikely(__sabo_core_ctx->num_cores_per_socket < num_threads))
+        if (unlikely(__sabo_core_ctx->max_process_cores < num_threads))
             process->counters.delta[step] = (double) -1;
 
         process->counters.num_threads[step] = num_threads;
@@ -503,13 +914,13 @@ static void core_compute_step_num_threads(void)
         int remaining;
 
         /* compute remaining cores */
-        remaining = __sabo_core_ctx->num_cores;
+        remaining = __sabo_core_ctx->num_weighted_cores;
         remaining -= core_update_step_processes_counters(i);
 
         /* allocated cores are necessarily <= total num_cores */
         ndebug(LOG_DEBUG_CORE, "remaining %d num_core: %d allocate: %d",
-               remaining, __sabo_core_ctx->num_cores,
-               __sabo_core_ctx->num_cores - remaining);
+               remaining, __sabo_core_ctx->num_weighted_cores,
+               __sabo_core_ctx->num_weighted_cores - remaining);
 
         /* need to dispatch the remaining cores to processes,
            let's do it by max remainders, after all they wanted more */
@@ -533,11 +944,21 @@ static int core_compute_step_process_avg(core_process_t *process)
     num_threads = (int) floor(avg);
     delta = avg - (double) num_threads;
 
-    if (unlikely(__sabo_core_ctx->num_cores_per_socket == num_threads))
+    if (unlikely(__sabo_core_ctx->max_process_cores == num_threads))
+        delta = (double) -1;
+
+    /* With the rank policy a light process keeps its threads on fewer
+     * physical cores and takes no remaining core, the cores it frees are
+     * dispatched to the loaded processes */
+    if (TOPO_SMT_RANK == topo_get_smt_policy() &&
+        1 < process->num_pus_per_core) {
+        num_threads = (num_threads + process->num_pus_per_core - 1) /
+            process->num_pus_per_core;
         delta = (double) -1;
+    }
 
     /* update_process_step_data computing propreties */
-    assert(num_threads <= __sabo_core_ctx->num_cores_per_socket);
+    assert(num_threads <= __sabo_core_ctx->max_process_cores);
     assert(0 < num_threads);
 
     ndebug(LOG_DEBUG_CORE, "wrank #%3d nrank #%3d avg: %f num_threads: %d "
@@ -564,11 +985,11 @@ static void core_compute_average_step_num_threads(void)
     }
 
     /* compute remaining cores */
-    remaining  = __sabo_core_ctx->num_cores - allocate;
+    remaining  = __sabo_core_ctx->num_weighted_cores - allocate;
 
     /* allocated cores are necessarily <= total num_cores */
     ndebug(LOG_DEBUG_CORE, "remaining %d num_core: %d allocate: %d",
-           remaining, __sabo_core_ctx->num_cores, allocate);
+           remaining, __sabo_core_ctx->num_weighted_cores, allocate);
 
     /* need to dispatch the remaining cores to processes,
        let's do it by max remainders, after all they wanted more */
@@ -620,6 +1041,7 @@ static int core_estimate_speedup(void) {
 
 static void core_compute_new_threads_distribution(void)
 {
+    core_compute_processes_pus_per_core();
     core_compute_step_num_threads();
     core_compute_average_step_num_threads();
 }
@@ -669,24 +1091,55 @@ static int core_compute_list_stop_value(core_socket_data_t *data)
 }
 #endif /* unused */
 
+/* Hardware threads per core of the process of a part */
+static int core_get_part_pus_per_core(const core_process_t *part)
+{
+    return __sabo_core_ctx->processes[part->node_rank].num_pus_per_core;
+}
+
+/* Fit the socket processes threads to the socket cores, sockets may have
+ * different num cores. The free cores are checked after each process so
+ * that a round stops on the exact socket size */
 static void core_adjust_list_num_threads(core_socket_data_t *data)
 {
+    int num_growing = 0;
+
     while(data->num_free_cores < 0) { /* Too many cores assigned */
-        for (int i = 0; i < data->num_processes; i++) {
+        const int num_free_cores = data->num_free_cores;
+
+        for (int i = 0; i < data->num_processes &&
+             data->num_free_cores < 0; i++) {
             core_process_t *process = data->processes[i];
 
             if (unlikely(1 == process->num_threads))
-                break;
+                continue;
 
             process->num_threads--;
             data->num_free_cores++;
         }
+
+        /* More processes than socket cores, the layout shares cores */
+        if (unlikely(num_free_cores == data->num_free_cores))
+            break;
+    }
+
+    /* Too few cores assigned: processes sharing their cores with sibling
+     * threads are the light ones, they only grow on a socket without any
+     * other process */
+    for (int i = 0; i < data->num_processes; i++) {
+        if (1 == core_get_part_pus_per_core(data->processes[i]))
+            num_growing++;
     }
 
-    while (data->num_free_cores > 0) { /* Too few cores assigned */
-        for (int i = 0; i < data->num_processes; i++) {
+    while (data->num_free_cores > 0 && 0 < data->num_processes) {
+        for (int i = 0; i < data->num_processes &&
+             data->num_free_cores > 0; i++) {
             core_process_t *process = data->processes[i];
 
+            if (0 < num_growing &&
+                1 < core_get_part_pus_per_core(process))
+                continue;
+
             process->num_threads++;
             data->num_free_cores--;
         }
@@ -701,55 +1154,225 @@ static void core_adjust_num_threads(void)
     }
 }
 
-static int core_compute_first_core_id(const core_socket_data_t *data,
-                      const int node_rank)
+/* Cores of the processes of each socket, the cores kept from the previous
+ * placement stay with their owner so that few threads move */
+static void core_assign_socket_cores(void)
 {
-    int start = 0;
+    int *num_threads = __sabo_core_ctx->layout_num_threads;
+    int *keys = __sabo_core_ctx->layout_keys;
+    int *priorities = __sabo_core_ctx->layout_priorities;
 
-    /* Compute my first core _id on socket */
-    for (int i = 0; i < data->num_processes; i++) {
-        if (data->processes[i]->node_rank == node_rank)
-            break;
-        start += data->processes[i]->num_threads;
+    for (int i = 0; i < __sabo_core_ctx->num_sockets; i++) {
+        core_socket_data_t *data = &(__sabo_core_ctx->data[i]);
+
+        /* Sort processes by rank to preserve deterministic placement */
+        core_sort_processes_by_rank(data);
+
+        for (int j = 0; j < data->num_processes; j++) {
+            num_threads[j] = data->processes[j]->num_threads;
+            keys[j] = data->processes[j]->node_rank;
+            priorities[j] = data->processes[j]->num_weighted_threads;
+        }
+
+        topo_get_socket_stable_layout(i, data->num_processes, keys,
+                          num_threads, priorities,
+                          data->core_owners,
+                          __sabo_core_ctx->layout_core_ids);
     }
+}
 
-    return start;
+/* Append the hardware threads of the process cores on a socket, returns
+ * the number of hardware threads */
+static int core_get_socket_pus(const core_process_t *process,
+                   const int socket_id, int num_pus)
+{
+    const core_socket_data_t *data = &(__sabo_core_ctx->data[socket_id]);
+    int *pu_ids = __sabo_core_ctx->pu_ids;
+    int num_cores = 0;
+
+    for (int i = 0; i < data->num_cores; i++) {
+        int core_id;
+        int num_core_pus;
+
+        if (data->core_owners[i] != process->node_rank)
+            continue;
+
+        core_id = topo_get_socket_core_id(socket_id, i);
+        num_core_pus = MIN(topo_get_core_num_pus(core_id),
+                   process->num_pus_per_core);
+
+        for (int j = 0; j < num_core_pus; j++)
+            pu_ids[num_pus++] = topo_get_core_pu_id(core_id, j);
+        num_cores++;
+    }
+
+    debug(LOG_DEBUG_CORE, "process wrank #%3d nrank %3d/%3d on socket "
+          "#%2d got %3d core(s)", process->world_rank, process->node_rank,
+          data->num_processes, socket_id, num_cores);
+
+    return num_pus;
+}
+
+/* Hardware thread of an omp thread staying where it is, -1 if its hardware
+ * thread is not one of the process or already taken */
+static int core_find_kept_pu(const int num_pus, const int cur_pu_id)
+{
+    for (int i = 0; i < num_pus; i++) {
+        if (__sabo_core_ctx->pu_ids[i] == cur_pu_id &&
+            !__sabo_core_ctx->pu_used[i])
+            return i;
+    }
+
+    return -1;
+}
+
+/* Bind one omp thread on each hardware thread of the process cores. The
+ * omp threads keep their hardware thread when the process still owns it,
+ * the others take the remaining ones and are dirty. Returns the dirty omp
+ * threads */
+static int core_bind_omp_threads(core_process_t *process, const int num_pus)
+{
+    int next = 0;
+    int num_dirty = 0;
+    int *pu_used = __sabo_core_ctx->pu_used;
+
+    for (int i = 0; i < num_pus; i++)
+        pu_used[i] = 0;
+
+    for (int i = 0; i < num_pus; i++) {
+        struct sys_bind_data *binding = &(process->binding[i]);
+        const int idx = core_find_kept_pu(num_pus, binding->cur_core_id);
+
+        binding->new_core_id = -1;
+        binding->dirty = 0;
+        if (-1 == idx)
+            continue;
+
+        binding->new_core_id = binding->cur_core_id;
+        pu_used[idx] = 1;
+    }
+
+    for (int i = 0; i < num_pus; i++) {
+        struct sys_bind_data *binding = &(process->binding[i]);
+
+        if (-1 != binding->new_core_id)
+            continue;
+
+        while (pu_used[next])
+            next++;
+
+        binding->new_core_id = __sabo_core_ctx->pu_ids[next];
+        binding->dirty = 1;
+        pu_used[next] = 1;
+        num_dirty++;
+    }
+
+    return num_dirty;
 }
 
 static void core_apply_new_placement(core_process_t *process)
 {
-    int start;
+    int num_dirty;
+    int num_omp_threads = 0;
 
-    const int socket_id = process->socket_id;
+    /* The process part comes first, then its extra parts */
+    for (int i = 0; i < __sabo_core_ctx->num_parts; i++) {
+        const core_process_t *part = &(__sabo_core_ctx->parts[i]);
 
-    /* Sort processes by rank to preserve deterministic placement */
-    core_sort_processes_by_rank(&(__sabo_core_ctx->data[socket_id]));
+        if (part->node_rank != process->node_rank)
+            continue;
 
-    /* Compute process first core */
-    start = core_compute_first_core_id(&(__sabo_core_ctx->data[socket_id]),
-                       process->node_rank);
+        num_omp_threads = core_get_socket_pus(process, part->socket_id,
+                              num_omp_threads);
+    }
 
-    debug(LOG_DEBUG_CORE, "process wrank #%3d nrank %3d/%3d on socket "
-          "#%2d got %3d thread(s) prev %3d thread(s)", process->world_rank,
-          process->node_rank, __sabo_core_ctx->data[socket_id].num_processes,
-          process->socket_id, process->num_threads, process->prev_num_threads);
+    /* Process without any core on an oversubscribed socket, its threads
+     * stay where they are */
+    if (unlikely(0 == num_omp_threads)) {
+        debug(LOG_DEBUG_CORE, "process wrank #%3d nrank %3d got no core",
+              process->world_rank, process->node_rank);
+        return;
+    }
+
+    num_dirty = core_bind_omp_threads(process, num_omp_threads);
 
-    if (process->num_threads == process->prev_num_threads &&
-        process->binding[0].cur_core_id == start &&
-        process->socket_id == process->prev_socket_id) {
+    __sabo_core_ctx->num_rebalances++;
+    __sabo_core_ctx->num_clean_threads += num_omp_threads - num_dirty;
+    __sabo_core_ctx->num_dirty_threads += num_dirty;
+
+    debug(LOG_DEBUG_CORE, "process wrank #%3d nrank %3d got %3d thread(s) "
+          "on %3d core(s) prev %3d core(s)", process->world_rank,
+          process->node_rank, num_omp_threads, process->num_threads,
+          process->prev_num_threads);
+
+    debug(LOG_DEBUG_PERF, "process wrank #%3d nrank %3d clean %3d dirty %3d "
+          "thread(s)", process->world_rank, process->node_rank,
+          num_omp_threads - num_dirty, num_dirty);
+
+    if (num_omp_threads == process->num_omp_threads && 0 == num_dirty) {
         debug(LOG_DEBUG_CORE, "Nothing to do");
         return; /* nothing to do */
     }
 
-    /* Iterate on socket core */
-    for (int i = 0; i < process->num_threads; i++) {
-        int cpu = start + i;
-        cpu = topo_get_socket_core_id(process->socket_id, cpu);
-        process->binding[i].new_core_id = cpu;
+    process->num_omp_threads = num_omp_threads;
+
+    if (unlikely(env_get_no_rebalance()))
+        return;
+
+    /* Publish the binding table before the new generation */
+    if (__sabo_core_ctx->lazy_binding)
+        __atomic_add_fetch(&(process->binding_generation), 1,
+                   __ATOMIC_RELEASE);
+
+    sabo_omp_rebalance(process);
+}
+
+/* Migrate the memory of the process when the set of its sockets changed
+ * or when the previous migration reached the step limit */
+static void core_follow_memory(const core_process_t *process)
+{
+    int changed = 0;
+    int num_sockets = 0;
+    int *sockets = __sabo_core_ctx->memory_sockets;
+    int *socket_ids = __sabo_core_ctx->memory_socket_ids;
+
+    if (likely(!__sabo_core_ctx->memory_follow))
+        return;
+
+    /* Flag the sockets of the process parts, then pack their ids */
+    for (int i = 0; i < __sabo_core_ctx->num_sockets; i++)
+        socket_ids[i] = 0;
+
+    for (int i = 0; i < __sabo_core_ctx->num_parts; i++) {
+        const core_process_t *part = &(__sabo_core_ctx->parts[i]);
+
+        if (part->node_rank == process->node_rank && 0 < part->num_threads)
+            socket_ids[part->socket_id] = 1;
     }
 
-    if (likely(!env_get_no_rebalance()))
-        sabo_omp_rebalance(process);
+    for (int i = 0; i < __sabo_core_ctx->num_sockets; i++) {
+        const int used = socket_ids[i];
+
+        if (sockets[i] != used)
+            changed = 1;
+
+        sockets[i] = used;
+        if (used)
+            socket_ids[num_sockets++] = i;
+    }
+
+    if (changed) {
+        __sabo_core_ctx->follow.cursor = 0;
+        __sabo_core_ctx->memory_pending = 1;
+    }
+
+    if (!__sabo_core_ctx->memory_pending || 0 == num_sockets)
+        return;
+
+    __sabo_core_ctx->memory_pending =
+        (0 == memory_follow_sockets(&(__sabo_core_ctx->follow), socket_ids,
+                        num_sockets,
+                        __sabo_core_ctx->memory_max_size));
 }
 
 static void core_gather_ompt_counters(core_process_t *process)
@@ -759,10 +1382,11 @@ static void core_gather_ompt_counters(core_process_t *process)
 
     step = __sabo_core_ctx->step % __sabo_core_ctx->window;
 
-    for (int i = 0; i < __sabo_core_ctx->num_cores; i++)
+    for (int i = 0; i < __sabo_core_ctx->max_num_threads; i++)
         sum += process->ompt.elapsed[i];
 
-    process->counters.elapsed[step] = sum;
+    /* Sibling threads share their core, keep the elapsed in core time */
+    process->counters.elapsed[step] = sum / process->num_pus_per_core;
 }
 
 ompt_threads_data_t *sabo_core_get_ompt_data(void)
@@ -774,7 +1398,7 @@ void sabo_core_reset_ompt_data(void)
 {
     ompt_threads_data_t *ompt_data = sabo_core_get_ompt_data();
 
-    for (int i = 0; i < __sabo_core_ctx->num_cores; i++)
+    for (int i = 0; i < __sabo_core_ctx->max_num_threads; i++)
         ompt_data->elapsed[i] = (double) 0;
 }
 
@@ -782,6 +1406,47 @@ int enabled_implicit_balancing(void)
 {
     return __sabo_core_ctx->implicit_balancing;
 }
+
+int sabo_core_is_balancing(void)
+{
+    return __sabo_core_ctx->balancing;
+}
+
+void sabo_core_enable_lazy_binding(void)
+{
+    __sabo_core_ctx->lazy_binding = 1;
+}
+
+int enabled_lazy_binding(void)
+{
+    return __sabo_core_ctx->lazy_binding;
+}
+
+/* Apply the last published binding of an omp thread, once per generation.
+ * Each omp thread only touches its own binding, no barrier is needed */
+void sabo_core_bind_omp_thread(const int tid)
+{
+    int generation;
+    struct sys_bind_data *binding;
+    core_process_t *process = __sabo_core_ctx->myprocess;
+
+    generation = __atomic_load_n(&(process->binding_generation),
+                     __ATOMIC_ACQUIRE);
+
+    /* No binding published yet */
+    if (likely(0 == generation) ||
+        unlikely(tid >= __sabo_core_ctx->max_num_threads))
+        return;
+
+    binding = &(process->binding[tid]);
+    if (likely(binding->generation == generation))
+        return;
+
+    binding->generation = generation;
+
+    if (tid < process->num_omp_threads)
+        sabo_set_thread_affinity(binding);
+}
 /**
  * OMP balanced
  **/
@@ -791,6 +1456,8 @@ void __sabo_omp_balanced__(void)
 
     const double start = sabo_omp_get_wtime();
 
+    __sabo_core_ctx->balancing = 1;
+
     /* Sum all threads time cycle get by OMPT
      * keep track of current step time in tab of all step times */
     core_gather_ompt_counters(__sabo_core_ctx->myprocess);
@@ -816,19 +1483,30 @@ void __sabo_omp_balanced__(void)
     /* Build process list with requested num threads */
     core_prepare_processes();
 
+    /* Split the processes larger than a socket into per socket parts */
+    core_split_processes();
+
     /* Compute best placement with branch & cut algorithme */
-    decision_tree_compute_placement(__sabo_core_ctx->processes);
+    decision_tree_compute_placement(__sabo_core_ctx->parts);
 
     /* Dispatch processes into socket processes list */
     core_dispatch_processes();
 
     /* Adapt processes num_threads to match num_cores_per_socket */
     core_adjust_num_threads();
+    core_gather_processes_parts();
+
+    /* Keep the cores of the previous placement when possible */
+    core_assign_socket_cores();
 
     /* Set omp_num_threads and rebind omp threads */
     core_apply_new_placement(__sabo_core_ctx->myprocess);
 
+    /* Move the memory next to the new cores */
+    core_follow_memory(__sabo_core_ctx->myprocess);
+
 LEAVE:
+    __sabo_core_ctx->balancing = 0;
     __sabo_core_ctx->step++;
     sabo_core_reset_ompt_data();
 
@@ -848,6 +1526,7 @@ int sabo_core_init(void)
 {
     env_variables_init();
     topo_init();
+    sabo_binding_init();
 
     const int num_sockets = topo_get_num_sockets();
     const int num_cores_per_socket = topo_get_num_cores_per_socket();
@@ -857,9 +1536,34 @@ int sabo_core_init(void)
     __sabo_core_ctx->window = env_get_num_steps_exchanged();
     __sabo_core_ctx->num_sockets = num_sockets;
     __sabo_core_ctx->num_cores_per_socket = num_cores_per_socket;
-    __sabo_core_ctx->num_cores = num_sockets * num_cores_per_socket;
+    __sabo_core_ctx->num_cores = topo_get_num_usable_cores();
+    __sabo_core_ctx->max_num_threads = __sabo_core_ctx->num_cores *
+        topo_get_num_smt();
+
+    for (int i = 0; i < num_sockets; i++) {
+        const int num_weighted_cores = core_compute_weighted_cores(i);
+
+        __sabo_core_ctx->num_weighted_cores += num_weighted_cores;
+        __sabo_core_ctx->max_weighted_cores =
+            MAX(__sabo_core_ctx->max_weighted_cores, num_weighted_cores);
+    }
     __sabo_core_ctx->implicit_balancing = env_get_implicit_balancing();
 
+    __sabo_core_ctx->spanning = (1 < num_sockets) ? env_get_spanning() : 0;
+    __sabo_core_ctx->max_process_cores = (__sabo_core_ctx->spanning) ?
+        __sabo_core_ctx->num_weighted_cores :
+        __sabo_core_ctx->max_weighted_cores;
+
+    __sabo_core_ctx->memory_follow = env_get_memory_follow();
+    if (__sabo_core_ctx->memory_follow) {
+        __sabo_core_ctx->memory_max_size =
+            (size_t) env_get_memory_follow_max_mb() << 20;
+        __sabo_core_ctx->memory_sockets =
+            xzalloc(sizeof(int) * (size_t) num_sockets);
+        __sabo_core_ctx->memory_socket_ids =
+            xzalloc(sizeof(int) * (size_t) num_sockets);
+    }
+
     /* Allocate one process to collect ompt data */
     __sabo_core_ctx->myprocess = xzalloc(sizeof(core_process_t));
     sabo_core_init_process(__sabo_core_ctx->myprocess);
@@ -883,6 +1587,16 @@ void sabo_core_fini(double start_time)
           __sabo_core_ctx->cumulate_elapsed, __sabo_core_ctx->mpi_elapsed,
           __sabo_core_ctx->cumulate_elapsed - __sabo_core_ctx->mpi_elapsed);
 
+    debug(LOG_DEBUG_PERF, "%d rebalance(s) clean %d dirty %d thread(s)",
+          __sabo_core_ctx->num_rebalances,
+          __sabo_core_ctx->num_clean_threads,
+          __sabo_core_ctx->num_dirty_threads);
+
+    if (__sabo_core_ctx->memory_follow)
+        debug(LOG_DEBUG_PERF, "memory follow %zu MB in %.6f second(s)",
+              __sabo_core_ctx->follow.total_size >> 20,
+              __sabo_core_ctx->follow.total_elapsed);
+
     core_fini_context();
     __sabo_core_ctx = NULL;
 
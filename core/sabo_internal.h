@@ -29,11 +29,23 @@ struct core_process {
     int prev_socket_id;
     int prev_num_threads;
 
+    /* Hardware threads used on each core and resulting omp threads */
+    int num_pus_per_core;
+    int num_omp_threads;
+
     /* Algorithme computed values */
     struct core_counters counters;
 
     struct sys_bind_data *binding;
 
+    /* Incremented by each new binding, an omp thread applies its binding
+     * at its next implicit task if it did not see this generation yet */
+    int binding_generation;
+
+    /* Capacity weighted cores of a part before they become socket cores,
+     * the loaded parts take the fastest cores */
+    int num_weighted_threads;
+
     /* ompt thread counters */
     ompt_threads_data_t ompt;
 };
@@ -45,5 +57,10 @@ void sabo_core_fini(double start_time);
 ompt_threads_data_t *sabo_core_get_ompt_data(void);
 void sabo_core_reset_ompt_data(void);
 int enabled_implicit_balancing(void);
+int sabo_core_is_balancing(void);
+
+void sabo_core_enable_lazy_binding(void);
+int enabled_lazy_binding(void);
+void sabo_core_bind_omp_thread(const int tid);
 
 #endif /* #ifndef include_core_internal_h */
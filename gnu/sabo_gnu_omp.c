@@ -0,0 +1,423 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#include <dlfcn.h>
+#include <omp.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "sys.h"
+#include "compiler.h"
+#include "sabo.h"
+#include "sabo_internal.h"
+#include "sabo_gnu_omp.h"
+
+/**
+ * GNU libgomp runtime has no OMPT support: sabo interposes the parallel
+ * region entry points to time the regions and to rebind the omp threads.
+ * GCC lowers the combined parallel loop and sections constructs to their
+ * own entry points, all of them run the same sabo implicit task.
+ * LLVM and Intel runtimes also export the GOMP entry points, the OMPT tool
+ * handles them.
+ */
+
+struct gnu_region {
+    gnu_fn_t fn;
+    void *data;
+    /* The region is timed and balanced by sabo */
+    int balanced;
+    int pad0;
+};
+
+static void (*__sabo_gomp_parallel_func)(gnu_fn_t, void *, unsigned int,
+                     unsigned int) = NULL;
+static unsigned int (*__sabo_gomp_parallel_reductions_func)(gnu_fn_t, void *,
+                     unsigned int, unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_sections_func)(gnu_fn_t, void *,
+                     unsigned int, unsigned int, unsigned int) = NULL;
+
+/* Chunked schedules: static, dynamic and guided */
+static void (*__sabo_gomp_parallel_loop_static_func)(gnu_fn_t, void *,
+                     unsigned int, long, long, long, long,
+                     unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_loop_dynamic_func)(gnu_fn_t, void *,
+                     unsigned int, long, long, long, long,
+                     unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_loop_guided_func)(gnu_fn_t, void *,
+                     unsigned int, long, long, long, long,
+                     unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_loop_nonmonotonic_dynamic_func)(gnu_fn_t,
+                     void *, unsigned int, long, long, long, long,
+                     unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_loop_nonmonotonic_guided_func)(gnu_fn_t,
+                     void *, unsigned int, long, long, long, long,
+                     unsigned int) = NULL;
+
+/* Runtime schedule, the chunk size comes from OMP_SCHEDULE */
+static void (*__sabo_gomp_parallel_loop_runtime_func)(gnu_fn_t, void *,
+                     unsigned int, long, long, long,
+                     unsigned int) = NULL;
+static void (*__sabo_gomp_parallel_loop_nonmonotonic_runtime_func)(gnu_fn_t,
+                     void *, unsigned int, long, long, long,
+                     unsigned int) = NULL;
+static void
+(*__sabo_gomp_parallel_loop_maybe_nonmonotonic_runtime_func)(gnu_fn_t,
+                     void *, unsigned int, long, long, long,
+                     unsigned int) = NULL;
+
+/* -1 until the first parallel region, then 1 with libgomp */
+static int sabo_gnu_enabled = -1;
+static double sabo_gnu_start_time = 0;
+
+/* Several application threads may start their first region at the same
+ * time, the init runs once */
+static pthread_once_t sabo_gnu_once = PTHREAD_ONCE_INIT;
+
+static __thread int __reenter__ = 0;
+
+/* Entry points missing from an older libgomp stay NULL, the application
+ * can not call them */
+static void *sabo_gnu_dlsym(const char *name)
+{
+    void *func;
+
+    dlerror();    /* Clear any existing error */
+
+    func = dlsym(RTLD_NEXT, name);
+
+    if (NULL != dlerror()) {
+        debug(LOG_DEBUG_OMPT, "No %s in the omp runtime", name);
+        return NULL;
+    }
+
+    return func;
+}
+
+static void sabo_gnu_init(void)
+{
+    * (void **) (&__sabo_gomp_parallel_func) =
+        sabo_gnu_dlsym("GOMP_parallel");
+
+    if (unlikely(NULL == __sabo_gomp_parallel_func))
+        fatal_error("Failed dlsym GOMP_parallel");
+
+    * (void **) (&__sabo_gomp_parallel_reductions_func) =
+        sabo_gnu_dlsym("GOMP_parallel_reductions");
+    * (void **) (&__sabo_gomp_parallel_sections_func) =
+        sabo_gnu_dlsym("GOMP_parallel_sections");
+    * (void **) (&__sabo_gomp_parallel_loop_static_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_static");
+    * (void **) (&__sabo_gomp_parallel_loop_dynamic_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_dynamic");
+    * (void **) (&__sabo_gomp_parallel_loop_guided_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_guided");
+    * (void **) (&__sabo_gomp_parallel_loop_nonmonotonic_dynamic_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_nonmonotonic_dynamic");
+    * (void **) (&__sabo_gomp_parallel_loop_nonmonotonic_guided_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_nonmonotonic_guided");
+    * (void **) (&__sabo_gomp_parallel_loop_runtime_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_runtime");
+    * (void **) (&__sabo_gomp_parallel_loop_nonmonotonic_runtime_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_nonmonotonic_runtime");
+    * (void **) (&__sabo_gomp_parallel_loop_maybe_nonmonotonic_runtime_func) =
+        sabo_gnu_dlsym("GOMP_parallel_loop_maybe_nonmonotonic_runtime");
+
+    sabo_gnu_enabled = (NULL == dlsym(RTLD_DEFAULT, "__kmpc_fork_call"));
+    if (!sabo_gnu_enabled)
+        return;
+
+    debug(LOG_DEBUG_OMPT, "GNU libgomp runtime, interpose GOMP_parallel*");
+
+    sabo_gnu_start_time = omp_get_wtime();
+
+    sabo_core_init(); /* internal initialization */
+
+    /* Each omp thread rebinds itself when it enters the next region */
+    sabo_core_enable_lazy_binding();
+}
+
+static void __attribute__((destructor)) sabo_gnu_fini(void)
+{
+    if (1 == sabo_gnu_enabled)
+        sabo_core_fini(sabo_gnu_start_time);
+}
+
+/* Implicit task of each omp thread of the region */
+static void sabo_gnu_implicit_task(void *ptr)
+{
+    const struct gnu_region *region = (const struct gnu_region *) ptr;
+    const int tid = omp_get_thread_num();
+
+    sabo_core_bind_omp_thread(tid);
+
+    region->fn(region->data);
+
+    /* skip master thread to avoid double counting */
+    if (0 != tid) {
+        ompt_threads_data_t *data;
+        data = sabo_core_get_ompt_data();
+        if (likely(tid < data->num_threads))
+            data->elapsed[tid] += omp_get_wtime() - data->start;
+    }
+}
+
+/* Start an interposed region. Only the outermost regions of the
+ * application are balanced, the others run the application function */
+static void sabo_gnu_region_begin(struct gnu_region *region, gnu_fn_t fn,
+                  void *data)
+{
+    ompt_threads_data_t *ompt_data;
+
+    pthread_once(&sabo_gnu_once, sabo_gnu_init);
+
+    region->fn = fn;
+    region->data = data;
+    region->balanced = 0;
+
+    if (!sabo_gnu_enabled || __reenter__ || 0 != omp_get_level() ||
+        sabo_core_is_balancing())
+        return;
+
+    region->balanced = 1;
+
+    ompt_data = sabo_core_get_ompt_data();
+    ompt_data->start = omp_get_wtime();
+    ompt_data->num_calls++;
+}
+
+static void sabo_gnu_region_end(const struct gnu_region *region)
+{
+    ompt_threads_data_t *ompt_data;
+
+    if (!region->balanced)
+        return;
+
+    ompt_data = sabo_core_get_ompt_data();
+    ompt_data->elapsed[0] = omp_get_wtime() - ompt_data->start;
+
+    if (enabled_implicit_balancing()) {
+        /* sabo own parallel regions are not balanced */
+        __reenter__ = 1;
+        sabo_omp_balanced();
+        __reenter__ = 0;
+    }
+}
+
+/* Outlined function and argument given to the runtime */
+static gnu_fn_t sabo_gnu_region_fn(const struct gnu_region *region)
+{
+    return region->balanced ? sabo_gnu_implicit_task : region->fn;
+}
+
+static void *sabo_gnu_region_data(struct gnu_region *region)
+{
+    return region->balanced ? (void *) region : region->data;
+}
+
+static void sabo_gnu_check_entry(const int found, const char *name)
+{
+    if (unlikely(!found))
+        fatal_error("No %s in the omp runtime", name);
+}
+
+void GOMP_parallel(gnu_fn_t fn, void *data, unsigned int num_threads,
+           unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+
+    __sabo_gomp_parallel_func(sabo_gnu_region_fn(&region),
+                  sabo_gnu_region_data(&region), num_threads,
+                  flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+unsigned int GOMP_parallel_reductions(gnu_fn_t fn, void *data,
+                      unsigned int num_threads,
+                      unsigned int flags)
+{
+    unsigned int ret;
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_reductions_func,
+                 __func__);
+
+    ret = __sabo_gomp_parallel_reductions_func(sabo_gnu_region_fn(&region),
+                           sabo_gnu_region_data(&region),
+                           num_threads, flags);
+
+    sabo_gnu_region_end(&region);
+
+    return ret;
+}
+
+void GOMP_parallel_sections(gnu_fn_t fn, void *data, unsigned int num_threads,
+                unsigned int count, unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_sections_func,
+                 __func__);
+
+    __sabo_gomp_parallel_sections_func(sabo_gnu_region_fn(&region),
+                       sabo_gnu_region_data(&region),
+                       num_threads, count, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_static(gnu_fn_t fn, void *data,
+                   unsigned int num_threads, long start, long end,
+                   long incr, long chunk_size, unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_loop_static_func,
+                 __func__);
+
+    __sabo_gomp_parallel_loop_static_func(sabo_gnu_region_fn(&region),
+                          sabo_gnu_region_data(&region),
+                          num_threads, start, end, incr,
+                          chunk_size, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_dynamic(gnu_fn_t fn, void *data,
+                unsigned int num_threads, long start, long end,
+                long incr, long chunk_size, unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_loop_dynamic_func,
+                 __func__);
+
+    __sabo_gomp_parallel_loop_dynamic_func(sabo_gnu_region_fn(&region),
+                           sabo_gnu_region_data(&region),
+                           num_threads, start, end, incr,
+                           chunk_size, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_guided(gnu_fn_t fn, void *data,
+                   unsigned int num_threads, long start, long end,
+                   long incr, long chunk_size, unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_loop_guided_func,
+                 __func__);
+
+    __sabo_gomp_parallel_loop_guided_func(sabo_gnu_region_fn(&region),
+                          sabo_gnu_region_data(&region),
+                          num_threads, start, end, incr,
+                          chunk_size, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_nonmonotonic_dynamic(gnu_fn_t fn, void *data,
+                         unsigned int num_threads,
+                         long start, long end, long incr,
+                         long chunk_size,
+                         unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(
+        NULL != __sabo_gomp_parallel_loop_nonmonotonic_dynamic_func,
+        __func__);
+
+    __sabo_gomp_parallel_loop_nonmonotonic_dynamic_func(
+        sabo_gnu_region_fn(&region), sabo_gnu_region_data(&region),
+        num_threads, start, end, incr, chunk_size, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_nonmonotonic_guided(gnu_fn_t fn, void *data,
+                        unsigned int num_threads,
+                        long start, long end, long incr,
+                        long chunk_size,
+                        unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(
+        NULL != __sabo_gomp_parallel_loop_nonmonotonic_guided_func,
+        __func__);
+
+    __sabo_gomp_parallel_loop_nonmonotonic_guided_func(
+        sabo_gnu_region_fn(&region), sabo_gnu_region_data(&region),
+        num_threads, start, end, incr, chunk_size, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_runtime(gnu_fn_t fn, void *data,
+                unsigned int num_threads, long start, long end,
+                long incr, unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(NULL != __sabo_gomp_parallel_loop_runtime_func,
+                 __func__);
+
+    __sabo_gomp_parallel_loop_runtime_func(sabo_gnu_region_fn(&region),
+                           sabo_gnu_region_data(&region),
+                           num_threads, start, end, incr,
+                           flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_nonmonotonic_runtime(gnu_fn_t fn, void *data,
+                         unsigned int num_threads,
+                         long start, long end, long incr,
+                         unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(
+        NULL != __sabo_gomp_parallel_loop_nonmonotonic_runtime_func,
+        __func__);
+
+    __sabo_gomp_parallel_loop_nonmonotonic_runtime_func(
+        sabo_gnu_region_fn(&region), sabo_gnu_region_data(&region),
+        num_threads, start, end, incr, flags);
+
+    sabo_gnu_region_end(&region);
+}
+
+void GOMP_parallel_loop_maybe_nonmonotonic_runtime(gnu_fn_t fn, void *data,
+                           unsigned int num_threads,
+                           long start, long end,
+                           long incr,
+                           unsigned int flags)
+{
+    struct gnu_region region;
+
+    sabo_gnu_region_begin(&region, fn, data);
+    sabo_gnu_check_entry(
+        NULL != __sabo_gomp_parallel_loop_maybe_nonmonotonic_runtime_func,
+        __func__);
+
+    __sabo_gomp_parallel_loop_maybe_nonmonotonic_runtime_func(
+        sabo_gnu_region_fn(&region), sabo_gnu_region_data(&region),
+        num_threads, start, end, incr, flags);
+
+    sabo_gnu_region_end(&region);
+}
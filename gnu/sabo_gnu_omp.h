@@ -0,0 +1,53 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#ifndef __include_sabo_gnu_omp_h
+#define __include_sabo_gnu_omp_h
+
+/* Outlined function of a parallel region */
+typedef void (*gnu_fn_t)(void *);
+
+/* libgomp parallel region entry points, interposed by sabo */
+void GOMP_parallel(gnu_fn_t fn, void *data, unsigned int num_threads,
+           unsigned int flags);
+unsigned int GOMP_parallel_reductions(gnu_fn_t fn, void *data,
+                      unsigned int num_threads,
+                      unsigned int flags);
+void GOMP_parallel_sections(gnu_fn_t fn, void *data, unsigned int num_threads,
+                unsigned int count, unsigned int flags);
+
+void GOMP_parallel_loop_static(gnu_fn_t fn, void *data,
+                   unsigned int num_threads, long start, long end,
+                   long incr, long chunk_size, unsigned int flags);
+void GOMP_parallel_loop_dynamic(gnu_fn_t fn, void *data,
+                unsigned int num_threads, long start, long end,
+                long incr, long chunk_size, unsigned int flags);
+void GOMP_parallel_loop_guided(gnu_fn_t fn, void *data,
+                   unsigned int num_threads, long start, long end,
+                   long incr, long chunk_size, unsigned int flags);
+void GOMP_parallel_loop_nonmonotonic_dynamic(gnu_fn_t fn, void *data,
+                         unsigned int num_threads,
+                         long start, long end, long incr,
+                         long chunk_size,
+                         unsigned int flags);
+void GOMP_parallel_loop_nonmonotonic_guided(gnu_fn_t fn, void *data,
+                        unsigned int num_threads,
+                        long start, long end, long incr,
+                        long chunk_size,
+                        unsigned int flags);
+
+void GOMP_parallel_loop_runtime(gnu_fn_t fn, void *data,
+                unsigned int num_threads, long start, long end,
+                long incr, unsigned int flags);
+void GOMP_parallel_loop_nonmonotonic_runtime(gnu_fn_t fn, void *data,
+                         unsigned int num_threads,
+                         long start, long end, long incr,
+                         unsigned int flags);
+void GOMP_parallel_loop_maybe_nonmonotonic_runtime(gnu_fn_t fn, void *data,
+                           unsigned int num_threads,
+                           long start, long end,
+                           long incr,
+                           unsigned int flags);
+
+#endif /* #ifndef __include_sabo_gnu_omp_h */
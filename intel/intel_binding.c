@@ -34,7 +34,7 @@ void sabo_intel_sys_bind_data_free(struct sys_bind_data *data)
 #endif /* ifdef SABO_RTINTEL */
 }
 
-void sabo_intel_set_thread_affinity(struct sys_bind_data *data)
+int sabo_intel_set_thread_affinity(struct sys_bind_data *data)
 {
 #ifdef SABO_RTINTEL
     int rc;
@@ -69,13 +69,22 @@ void sabo_intel_set_thread_affinity(struct sys_bind_data *data)
         error("Failed to move thread pid %d tid %d OS from %d to %d (rc %d)",
               getpid(), sys_get_tid(), data->cur_core_id,
               data->new_core_id, rc);
+
+        /* Restore the mask of the current core */
+        kmp_unset_affinity_mask_proc(data->new_core_id, mask);
+        if (data->cur_core_id != -1)
+            kmp_set_affinity_mask_proc(data->cur_core_id, mask);
+        return -1;
     }
 
     /* swap value in bind data */
     data->cur_core_id = data->new_core_id;
+
+    return 0;
 #else /* ifdef SABO_RTINTEL */
     UNUSED(data);
     fatal_error("only available with intel compiler");
+    return -1;
 #endif /* ifdef SABO_RTINTEL */
 }
 
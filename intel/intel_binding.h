@@ -9,7 +9,7 @@
 
 void sabo_intel_sys_bind_data_alloc(struct sys_bind_data *data);
 void sabo_intel_sys_bind_data_free(struct sys_bind_data *data);
-void sabo_intel_set_thread_affinity(struct sys_bind_data *data);
+int sabo_intel_set_thread_affinity(struct sys_bind_data *data);
 void sabo_intel_get_thread_affinity(struct sys_bind_data *data);
 
 #endif /* ifndef __include_intel_binding_h */
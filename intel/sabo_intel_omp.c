@@ -30,10 +30,14 @@ static void sabo_intel_move_thread(core_process_t *process)
 void sabo_intel_omp_rebalance(core_process_t *process)
 {
     /* Replace omp_num_threads old value */
-    omp_set_num_threads(process->num_threads);
+    omp_set_num_threads(process->num_omp_threads);
+
+    /* The omp threads rebind at the start of the next parallel region */
+    if (enabled_lazy_binding())
+        return;
 
     /* Force a fork to rebind omp threads */
-    #pragma omp parallel num_threads(process->num_threads)
+    #pragma omp parallel num_threads(process->num_omp_threads)
         sabo_intel_move_thread(process);
 }
 
@@ -13,7 +13,7 @@
 #include "sabo_ompt.h"
 #include "sabo_internal.h"
 
-#ifdef SABO_RTINTEL
+#ifdef SABO_USE_OMPT
 #include <omp.h>
 
 #include <omp-tools.h>
@@ -80,7 +80,8 @@ on_ompt_callback_sync_region(ompt_sync_region_t kind,
         if (0 != (tid = omp_get_thread_num())) {
             ompt_threads_data_t *data;
             data = sabo_core_get_ompt_data();
-            data->elapsed[tid] += omp_get_wtime() - data->start;
+            if (likely(tid < data->num_threads))
+                data->elapsed[tid] += omp_get_wtime() - data->start;
         }
 
 #ifdef SABO_USE_EZTRACE
@@ -167,6 +168,35 @@ on_ompt_callback_parallel_end(ompt_data_t *parallel_data,
     __reenter__ = false;
 }
 
+static void
+on_ompt_callback_implicit_task(ompt_scope_endpoint_t endpoint,
+                   ompt_data_t *parallel_data,
+                   ompt_data_t *task_data,
+                   unsigned int actual_parallelism,
+                   unsigned int index, int flags)
+{
+    /* Silent unsued ompt callback parameters */
+    UNUSED(parallel_data);
+    UNUSED(task_data);
+    UNUSED(actual_parallelism);
+
+    if (ompt_scope_begin != endpoint || (flags & ompt_task_initial))
+        return;
+
+    /* Bindings are computed for the threads of the outermost team */
+    if (1 < omp_get_level())
+        return;
+
+    /* protection against reentrance */
+    if (unlikely(__reenter__))
+      return;
+    __reenter__ = true;
+
+    sabo_core_bind_omp_thread((int) index);
+
+    __reenter__ = false;
+}
+
 static int
 ompt_initialize(ompt_function_lookup_t lookup,
         int initial_device_num,
@@ -187,6 +217,12 @@ ompt_initialize(ompt_function_lookup_t lookup,
     register_callback(ompt_callback_parallel_end);
     register_callback(ompt_callback_sync_region);
 
+    /* Without implicit task events the threads rebind in an extra parallel
+     * region */
+    if (ompt_set_always == ompt_set_callback(ompt_callback_implicit_task,
+                (ompt_callback_t) &on_ompt_callback_implicit_task))
+        sabo_core_enable_lazy_binding();
+
     return 1;
 }
 
@@ -196,6 +232,10 @@ ompt_finalize(ompt_data_t* data)
     sabo_core_fini((double) data->value);
 }
 
+/* Entry point looked up by the runtime, omp-tools.h does not declare it */
+ompt_start_tool_result_t* ompt_start_tool(unsigned int omp_version,
+                      const char *runtime_version);
+
 ompt_start_tool_result_t* ompt_start_tool(
         unsigned int omp_version,
         const char *runtime_version)
@@ -214,4 +254,4 @@ ompt_start_tool_result_t* ompt_start_tool(
     return &ompt_start_tool_result;
 }
 
-#endif /* #ifdef SABO_RTINTEL */
+#endif /* #ifdef SABO_USE_OMPT */
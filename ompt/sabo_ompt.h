@@ -9,7 +9,8 @@ struct ompt_threads_data {
     double start; /* master parallel begin */
     double *elapsed; /* omp paralel elapsed time */
     int num_calls;
-    int pad0;
+    int num_threads; /* elapsed size, threads of larger teams are not
+                counted */
 };
 typedef struct ompt_threads_data ompt_threads_data_t;
 
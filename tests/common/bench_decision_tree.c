@@ -0,0 +1,296 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <omp.h>
+
+#include "env.h"
+#include "sys.h"
+#include "decision_tree.h"
+
+#define BENCH_NUM_RUNS 16
+#define BENCH_NUM_STEPS 64
+
+/* Runs are independent placements */
+#define BENCH_FLAGS    (DECISION_TREE_FLAGS_DEFAULT & \
+             ~DECISION_TREE_FLAG_INCREMENTAL)
+
+struct bench_config {
+    int num_sockets;
+    int num_cores_per_socket;
+    int num_processes;
+
+    /* No prev_socket_id, first balancing step */
+    int first_step;
+
+    /* Run the node copying solver and the backtracking solver without
+     * optimizations */
+    int reference;
+
+    /* Too large to be solved without the placement bound */
+    int bound_only;
+};
+
+static const struct bench_config bench_configs[] = {
+    { 2, 24, 4, 0, 1, 0 },
+    { 2, 64, 4, 0, 1, 0 },
+    { 2, 32, 12, 0, 1, 0 },
+    { 2, 64, 16, 0, 1, 0 },
+    { 4, 8, 10, 0, 1, 0 },
+    { 4, 12, 10, 0, 1, 0 },
+    { 4, 16, 12, 1, 1, 0 },
+    { 3, 32, 24, 0, 0, 1 },
+    { 8, 16, 16, 1, 0, 0 },
+    { 4, 32, 16, 0, 0, 1 },
+    { 8, 32, 16, 1, 0, 1 },
+};
+
+/* Reproducible thread distribution using all cores of the node */
+static void bench_init_processes(core_process_t *processes,
+                 const struct bench_config *config,
+                 unsigned int seed)
+{
+    const int num_processes = config->num_processes;
+    int remaining = config->num_sockets * config->num_cores_per_socket;
+
+    for (int i = 0; i < num_processes; i++) {
+        core_process_t *process = &(processes[i]);
+        int num_threads = 1;
+
+        seed = seed * 1103515245 + 12345;
+
+        if (i == num_processes - 1) {
+            num_threads = remaining;
+        } else if (remaining > num_processes - i) {
+            int max = remaining - (num_processes - i - 1);
+            max = MIN(max, config->num_cores_per_socket);
+            num_threads += (int) ((seed >> 16) % (unsigned int) max);
+        }
+
+        remaining -= num_threads;
+
+        process->node_rank = i;
+        process->prev_socket_id = (i * config->num_sockets) / num_processes;
+        if (config->first_step)
+            process->prev_socket_id = -1;
+        process->prev_num_threads = num_threads;
+        process->socket_id = -1;
+        process->num_threads = num_threads;
+    }
+}
+
+static void bench_solver(const struct bench_config *config,
+             const enum decision_tree_solver solver, const int flags,
+             const int reference, core_process_t *processes,
+             int *socket_ids)
+{
+    uint64_t num_lookups;
+    double elapsed = (double) 0;
+    struct decision_tree_stats stats;
+    struct decision_tree_stats total;
+
+    memset(&total, 0, sizeof(struct decision_tree_stats));
+
+    decision_tree_set_solver(solver);
+    decision_tree_set_flags(flags);
+
+    for (unsigned int seed = 0; seed < BENCH_NUM_RUNS; seed++) {
+        double start;
+
+        bench_init_processes(processes, config, seed);
+
+        start = omp_get_wtime();
+        decision_tree_compute_placement(processes);
+        elapsed += omp_get_wtime() - start;
+
+        decision_tree_get_stats(&stats);
+        total.num_nodes += stats.num_nodes;
+        total.num_candidates += stats.num_candidates;
+        total.num_copy_bytes += stats.num_copy_bytes;
+        total.num_allocs += stats.num_allocs;
+        total.num_tt_hits += stats.num_tt_hits;
+        total.num_tt_misses += stats.num_tt_misses;
+
+        /* Solvers must agree on the placement */
+        for (int i = 0; i < config->num_processes; i++) {
+            const int idx = (int) seed * config->num_processes + i;
+
+            if (reference)
+                socket_ids[idx] = processes[i].socket_id;
+            else
+                assert(socket_ids[idx] == processes[i].socket_id);
+        }
+    }
+
+    num_lookups = total.num_tt_hits + total.num_tt_misses;
+
+    printf("%dx%-3d %3d process(es)%s %-9s flags 0x%02x %12.3f usec "
+           "%12.0f nodes %14.0f bytes %8.0f allocs %5.1f%% tt hits\n",
+           config->num_sockets,
+           config->num_cores_per_socket, config->num_processes,
+           (config->first_step) ? " first step" : "",
+           decision_tree_get_solver_name(solver), flags,
+           elapsed * 1000000 / BENCH_NUM_RUNS,
+           (double) total.num_nodes / BENCH_NUM_RUNS,
+           (double) total.num_copy_bytes / BENCH_NUM_RUNS,
+           (double) total.num_allocs / BENCH_NUM_RUNS,
+           (0 < num_lookups) ?
+           (double) total.num_tt_hits * 100 / (double) num_lookups : 0.0);
+}
+
+static void bench_config(const struct bench_config *config)
+{
+    int *socket_ids;
+    core_process_t *processes;
+
+    const size_t num_processes = (size_t) config->num_processes;
+
+    processes = xzalloc(sizeof(core_process_t) * num_processes);
+    socket_ids = xzalloc(sizeof(int) * num_processes * BENCH_NUM_RUNS);
+
+    decision_tree_init(config->num_sockets, config->num_cores_per_socket,
+               config->num_processes);
+    decision_tree_set_num_threads(1);
+
+    /* Node copying solver first, it is the placement reference */
+    if (config->reference) {
+        bench_solver(config, DECISION_TREE_SOLVER_COPY, 0, 1, processes,
+                 socket_ids);
+        bench_solver(config, DECISION_TREE_SOLVER_BACKTRACK, 0, 0,
+                 processes, socket_ids);
+    }
+
+    if (!config->bound_only)
+        bench_solver(config, DECISION_TREE_SOLVER_BACKTRACK,
+                 BENCH_FLAGS & ~DECISION_TREE_FLAG_BOUND,
+                 !config->reference, processes, socket_ids);
+
+    bench_solver(config, DECISION_TREE_SOLVER_BACKTRACK, BENCH_FLAGS,
+             config->bound_only, processes, socket_ids);
+
+    /* Exact solver on the topologies it is selected for */
+    decision_tree_set_solver(DECISION_TREE_SOLVER_AUTO);
+    if (DECISION_TREE_SOLVER_DP == decision_tree_get_active_solver())
+        bench_solver(config, DECISION_TREE_SOLVER_DP, BENCH_FLAGS, 0,
+                 processes, socket_ids);
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* Balancing steps from the previous placement, one thread moves every
+ * fourth step */
+static void bench_steps_solver(const struct bench_config *config,
+                   const int flags, const int reference,
+                   core_process_t *processes, int *socket_ids)
+{
+    double elapsed = (double) 0;
+    uint64_t num_nodes = 0;
+    uint64_t num_reuses = 0;
+    struct decision_tree_stats stats;
+
+    const int num_processes = config->num_processes;
+
+    decision_tree_set_flags(flags);
+
+    bench_init_processes(processes, config, 0);
+
+    for (int step = 0; step < BENCH_NUM_STEPS; step++) {
+        double start;
+        int src = (step * 7) % num_processes;
+        const int dst = (step * 3 + 1) % num_processes;
+
+        while (1 == processes[src].num_threads)
+            src = (src + 1) % num_processes;
+
+        if (0 == step % 4 && src != dst) {
+            processes[src].num_threads--;
+            processes[dst].num_threads++;
+        }
+
+        /* Socket changes are counted from the previous placement */
+        if (0 < step) {
+            for (int i = 0; i < num_processes; i++)
+                processes[i].prev_socket_id = processes[i].socket_id;
+        }
+
+        start = omp_get_wtime();
+        decision_tree_compute_placement(processes);
+        elapsed += omp_get_wtime() - start;
+
+        decision_tree_get_stats(&stats);
+        num_nodes += stats.num_nodes;
+        num_reuses += stats.num_reuses;
+
+        for (int i = 0; i < num_processes; i++) {
+            const int idx = step * num_processes + i;
+
+            if (reference)
+                socket_ids[idx] = processes[i].socket_id;
+            else
+                assert(socket_ids[idx] == processes[i].socket_id);
+        }
+    }
+
+    printf("%dx%-3d %3d process(es) %d steps flags 0x%02x %12.3f usec "
+           "%12.0f nodes %5.1f%% reuses\n",
+           config->num_sockets, config->num_cores_per_socket,
+           num_processes, BENCH_NUM_STEPS, flags,
+           elapsed * 1000000 / BENCH_NUM_STEPS,
+           (double) num_nodes / BENCH_NUM_STEPS,
+           (double) num_reuses * 100 / BENCH_NUM_STEPS);
+}
+
+static void bench_steps(const struct bench_config *config)
+{
+    int *socket_ids;
+    core_process_t *processes;
+
+    const size_t num_processes = (size_t) config->num_processes;
+
+    processes = xzalloc(sizeof(core_process_t) * num_processes);
+    socket_ids = xzalloc(sizeof(int) * num_processes * BENCH_NUM_STEPS);
+
+    decision_tree_init(config->num_sockets, config->num_cores_per_socket,
+               config->num_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+
+    bench_steps_solver(config, BENCH_FLAGS, 1, processes, socket_ids);
+    bench_steps_solver(config, DECISION_TREE_FLAGS_DEFAULT, 0, processes,
+               socket_ids);
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+int main(int argc, char *argv[])
+{
+    const int num_configs = (int) (sizeof(bench_configs) /
+                       sizeof(struct bench_config));
+
+    /* Silent unsued main arguments */
+    UNUSED(argc);
+    UNUSED(argv);
+
+    env_get_log_debug();
+
+    for (int i = 0; i < num_configs; i++)
+        bench_config(&(bench_configs[i]));
+
+    for (int i = 0; i < num_configs; i++) {
+        if (!bench_configs[i].first_step && !bench_configs[i].bound_only)
+            bench_steps(&(bench_configs[i]));
+    }
+
+    printf("all done\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2021-2024 Bull SAS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+
+#include "env.h"
+#include "sys.h"
+#include "decision_tree.h"
+
+#define BENCH_NUM_RUNS 32
+
+/* Explored nodes of the backtracking solver before it returns its best
+ * candidate, large nodes are not solved exhaustively */
+#define BENCH_BUDGET 20000
+
+/* Largest nodes solved by the exhaustive searches, their nodes and
+ * allocations are the regression reference of the solvers */
+#define BENCH_EXHAUSTIVE_MAX_PROCESSES 16
+#define BENCH_EXHAUSTIVE_MAX_SOCKETS 4
+#define BENCH_COPY_MAX_PROCESSES 16
+#define BENCH_COPY_MAX_SOCKETS 2
+
+/* Runs are independent placements */
+#define BENCH_FLAGS    (DECISION_TREE_FLAGS_DEFAULT & \
+             ~DECISION_TREE_FLAG_INCREMENTAL)
+
+enum bench_workload {
+    BENCH_WORKLOAD_RANDOM = 0,    /* random demand up to a socket */
+    BENCH_WORKLOAD_UNIFORM,        /* same demand, symmetric placements */
+    BENCH_WORKLOAD_SKEWED,        /* single thread processes and a few
+                       large ones */
+    BENCH_WORKLOAD_FRAGMENTED,    /* just over half a socket, two
+                       processes never share a socket */
+    BENCH_NUM_WORKLOADS
+};
+
+static const char *bench_workload_names[BENCH_NUM_WORKLOADS] = {
+    "random",
+    "uniform",
+    "skewed",
+    "fragmented"
+};
+
+static const int bench_num_sockets[] = { 1, 2, 4, 8 };
+static const int bench_num_cores_per_socket[] = { 8, 32, 128 };
+static const int bench_num_processes[] = { 2, 16, 64, 256 };
+
+#define BENCH_ARRAY_SIZE(array) ((int) (sizeof(array) / sizeof(array[0])))
+
+struct bench_config {
+    int num_sockets;
+    int num_cores_per_socket;
+    int num_processes;
+    enum bench_workload workload;
+};
+
+/* Solver runs of each node size, 0 budget for an exhaustive search */
+struct bench_solver {
+    enum decision_tree_solver solver;
+    int budget;
+    int max_sockets;
+    int max_processes;
+};
+
+static const struct bench_solver bench_solvers[] = {
+    { DECISION_TREE_SOLVER_AUTO, BENCH_BUDGET, INT_MAX, INT_MAX },
+    { DECISION_TREE_SOLVER_BACKTRACK, 0, BENCH_EXHAUSTIVE_MAX_SOCKETS,
+      BENCH_EXHAUSTIVE_MAX_PROCESSES },
+    { DECISION_TREE_SOLVER_COPY, 0, BENCH_COPY_MAX_SOCKETS,
+      BENCH_COPY_MAX_PROCESSES }
+};
+
+static unsigned int bench_rand(unsigned int *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 16;
+}
+
+/* Requested num threads of a process before the node capacity fix up */
+static int bench_target_num_threads(const struct bench_config *config,
+                    const int idx, unsigned int *seed)
+{
+    const int num_cores = config->num_sockets * config->num_cores_per_socket;
+    const int num_processes = config->num_processes;
+
+    switch (config->workload) {
+    case BENCH_WORKLOAD_RANDOM:
+        return 1 + (int) (bench_rand(seed) %
+                  (unsigned int) config->num_cores_per_socket);
+    case BENCH_WORKLOAD_UNIFORM:
+        return num_cores / num_processes +
+            ((idx < num_cores % num_processes) ? 1 : 0);
+    case BENCH_WORKLOAD_SKEWED:
+        return (idx < num_processes - num_processes / 4) ? 1 :
+            num_cores / MAX(1, num_processes / 4);
+    case BENCH_WORKLOAD_FRAGMENTED:
+        return config->num_cores_per_socket / 2 + 1;
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+/* Reproducible thread distribution using all cores of the node, the seed
+ * shuffles the processes ranks */
+static void bench_init_processes(core_process_t *processes,
+                 const struct bench_config *config,
+                 unsigned int seed)
+{
+    const int num_processes = config->num_processes;
+    int remaining = config->num_sockets * config->num_cores_per_socket;
+
+    for (int i = 0; i < num_processes; i++) {
+        core_process_t *process = &(processes[i]);
+        int num_threads = bench_target_num_threads(config, i, &seed);
+
+        /* Keep at least one core for each next process */
+        num_threads = MIN(num_threads, remaining - (num_processes - i - 1));
+        num_threads = MAX(num_threads, 1);
+        if (i == num_processes - 1)
+            num_threads = remaining;
+
+        remaining -= num_threads;
+
+        process->num_threads = num_threads;
+    }
+
+    for (int i = num_processes - 1; 0 < i; i--) {
+        const int j = (int) (bench_rand(&seed) % (unsigned int) (i + 1));
+        const int num_threads = processes[i].num_threads;
+
+        processes[i].num_threads = processes[j].num_threads;
+        processes[j].num_threads = num_threads;
+    }
+
+    for (int i = 0; i < num_processes; i++) {
+        core_process_t *process = &(processes[i]);
+
+        process->node_rank = i;
+        process->prev_socket_id = (i * config->num_sockets) / num_processes;
+        process->prev_num_threads = process->num_threads;
+        process->socket_id = -1;
+    }
+}
+
+static int bench_cmp_doubles(void const *ptr1, void const *ptr2)
+{
+    const double d1 = *((double const *) ptr1);
+    const double d2 = *((double const *) ptr2);
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+/* Nearest rank percentile of sorted values */
+static double bench_percentile(const double *sorted, const int num_values,
+                   const int percent)
+{
+    int rank = (percent * num_values + 99) / 100;
+
+    rank = MAX(rank, 1);
+
+    return sorted[rank - 1];
+}
+
+static void bench_workload(const struct bench_config *config,
+               const struct bench_solver *solver,
+               core_process_t *processes)
+{
+    int num_budgets = 0;
+    double elapsed[BENCH_NUM_RUNS];
+    uint64_t max_nodes = 0;
+    struct decision_tree_stats stats;
+    struct decision_tree_stats total;
+
+    memset(&total, 0, sizeof(struct decision_tree_stats));
+
+    for (unsigned int seed = 0; seed < BENCH_NUM_RUNS; seed++) {
+        double start;
+
+        bench_init_processes(processes, config, seed);
+
+        start = omp_get_wtime();
+        decision_tree_compute_placement(processes);
+        elapsed[seed] = (omp_get_wtime() - start) * 1000000;
+
+        decision_tree_get_stats(&stats);
+        total.num_nodes += stats.num_nodes;
+        total.num_allocs += stats.num_allocs;
+        total.num_copy_bytes += stats.num_copy_bytes;
+        max_nodes = MAX(max_nodes, stats.num_nodes);
+
+        if (0 < solver->budget &&
+            (uint64_t) solver->budget <= stats.num_nodes &&
+            DECISION_TREE_SOLVER_BACKTRACK == decision_tree_get_active_solver())
+            num_budgets++;
+
+        for (int i = 0; i < config->num_processes; i++)
+            assert(0 <= processes[i].socket_id &&
+                   config->num_sockets > processes[i].socket_id);
+    }
+
+    qsort(elapsed, BENCH_NUM_RUNS, sizeof(double), bench_cmp_doubles);
+
+    printf("%dx%-3d %3d process(es) %-10s %-9s %-10s p50 %10.3f p90 %10.3f "
+           "p99 %10.3f max %10.3f usec %10.0f nodes %8.0f max nodes "
+           "%6.1f allocs %10.1f copied KB %3d budget(s)\n",
+           config->num_sockets, config->num_cores_per_socket,
+           config->num_processes, bench_workload_names[config->workload],
+           decision_tree_get_solver_name(decision_tree_get_active_solver()),
+           (0 < solver->budget) ? "budget" : "exhaustive",
+           bench_percentile(elapsed, BENCH_NUM_RUNS, 50),
+           bench_percentile(elapsed, BENCH_NUM_RUNS, 90),
+           bench_percentile(elapsed, BENCH_NUM_RUNS, 99),
+           elapsed[BENCH_NUM_RUNS - 1],
+           (double) total.num_nodes / BENCH_NUM_RUNS, (double) max_nodes,
+           (double) total.num_allocs / BENCH_NUM_RUNS,
+           (double) total.num_copy_bytes / 1024 / BENCH_NUM_RUNS, num_budgets);
+}
+
+static void bench_config(struct bench_config *config)
+{
+    core_process_t *processes;
+
+    processes = xzalloc(sizeof(core_process_t) *
+                (size_t) config->num_processes);
+
+    decision_tree_init(config->num_sockets, config->num_cores_per_socket,
+               config->num_processes);
+    decision_tree_set_num_threads(1);
+    decision_tree_set_flags(BENCH_FLAGS);
+    decision_tree_set_cache_size(0);
+
+    for (int i = 0; i < BENCH_ARRAY_SIZE(bench_solvers); i++) {
+        const struct bench_solver *solver = &(bench_solvers[i]);
+
+        if (config->num_sockets > solver->max_sockets ||
+            config->num_processes > solver->max_processes)
+            continue;
+
+        decision_tree_set_solver(solver->solver);
+        decision_tree_set_budget(solver->budget);
+
+        for (int j = 0; j < BENCH_NUM_WORKLOADS; j++) {
+            config->workload = (enum bench_workload) j;
+            bench_workload(config, solver, processes);
+        }
+    }
+
+    decision_tree_fini();
+
+    xfree(processes);
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_config config;
+
+    /* Silent unsued main arguments */
+    UNUSED(argc);
+    UNUSED(argv);
+
+    env_get_log_debug();
+
+    for (int i = 0; i < BENCH_ARRAY_SIZE(bench_num_sockets); i++) {
+        for (int j = 0; j < BENCH_ARRAY_SIZE(bench_num_cores_per_socket); j++) {
+            for (int k = 0; k < BENCH_ARRAY_SIZE(bench_num_processes); k++) {
+                config.num_sockets = bench_num_sockets[i];
+                config.num_cores_per_socket = bench_num_cores_per_socket[j];
+                config.num_processes = bench_num_processes[k];
+
+                /* At least one thread per process */
+                if (config.num_processes >
+                    config.num_sockets * config.num_cores_per_socket)
+                    continue;
+
+                bench_config(&config);
+            }
+        }
+    }
+
+    printf("all done\n");
+    return EXIT_SUCCESS;
+}
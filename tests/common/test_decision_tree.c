@@ -6,7 +6,9 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
 
+#include "env.h"
 #include "sys.h"
 #include "decision_tree.h"
 
@@ -91,16 +93,688 @@ static void test_article_milan64_4ppn_1node(void)
     xfree(processes);
 }
 
+/* Reproducible thread distribution using all cores of the node */
+static void test_init_processes(core_process_t *processes,
+                const int num_processes, const int num_sockets,
+                const int num_cores_per_socket, unsigned int seed,
+                const int first_step)
+{
+    int remaining = num_sockets * num_cores_per_socket;
+
+    for (int i = 0; i < num_processes; i++) {
+        core_process_t *process = &(processes[i]);
+        int num_threads = 1;
+
+        seed = seed * 1103515245 + 12345;
+
+        if (i == num_processes - 1) {
+            num_threads = remaining;
+        } else if (remaining > num_processes - i) {
+            int max = remaining - (num_processes - i - 1);
+            max = MIN(max, num_cores_per_socket);
+            num_threads += (int) ((seed >> 16) % (unsigned int) max);
+        }
+
+        remaining -= num_threads;
+
+        process->node_rank = i;
+        process->prev_socket_id = (i * num_sockets) / num_processes;
+        if (first_step)
+            process->prev_socket_id = -1;
+        process->prev_num_threads = num_threads;
+        process->socket_id = -1;
+        process->num_threads = num_threads;
+    }
+}
+
+static void test_compute_placement(core_process_t *processes,
+                   const int num_processes, const int num_sockets,
+                   const int num_cores_per_socket,
+                   const unsigned int seed,
+                   const enum decision_tree_solver solver,
+                   const int num_threads)
+{
+    test_init_processes(processes, num_processes, num_sockets,
+                num_cores_per_socket, seed, 0);
+
+    decision_tree_set_solver(solver);
+    decision_tree_set_num_threads(num_threads);
+    decision_tree_compute_placement(processes);
+}
+
+/* Every solver mode must return the serial node copying placement */
+static void test_solvers(const int num_sockets, const int num_cores_per_socket,
+             const int num_processes)
+{
+    int *socket_ids;
+    core_process_t *processes;
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+
+    for (unsigned int seed = 0; seed < 8; seed++) {
+        test_compute_placement(processes, num_processes, num_sockets,
+                       num_cores_per_socket, seed,
+                       DECISION_TREE_SOLVER_COPY, 1);
+
+        for (int i = 0; i < num_processes; i++)
+            socket_ids[i] = processes[i].socket_id;
+
+        for (int j = 0; j < DECISION_TREE_NUM_SOLVERS; j++) {
+            const enum decision_tree_solver solver =
+                (enum decision_tree_solver) j;
+
+            test_compute_placement(processes, num_processes,
+                           num_sockets, num_cores_per_socket,
+                           seed, solver, 1);
+
+            for (int i = 0; i < num_processes; i++)
+                assert(socket_ids[i] == processes[i].socket_id);
+
+            test_compute_placement(processes, num_processes,
+                           num_sockets, num_cores_per_socket,
+                           seed, solver, 4);
+
+            for (int i = 0; i < num_processes; i++)
+                assert(socket_ids[i] == processes[i].socket_id);
+        }
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* Norme and move cost of a placement weighted by the move costs,
+ * processes are placed on each socket by increasing num threads. Return 0
+ * if a process is placed on an oversubscribed socket */
+static int test_oracle_eval(const core_process_t *processes,
+                const int *socket_ids, const int num_processes,
+                const int num_sockets, const int *num_cores,
+                const int *move_costs,
+                int *norme, int *move_cost)
+{
+    *norme = INT_MIN;
+    *move_cost = 0;
+
+    for (int i = 0; i < num_processes; i++) {
+        const int prev_socket_id = processes[i].prev_socket_id;
+
+        if (prev_socket_id == socket_ids[i])
+            continue;
+
+        /* Processes without prev_socket_id cost the same anywhere */
+        if (NULL == move_costs || 0 > prev_socket_id)
+            (*move_cost)++;
+        else
+            (*move_cost) += move_costs[prev_socket_id * num_sockets +
+                                socket_ids[i]];
+    }
+
+    for (int socket_id = 0; socket_id < num_sockets; socket_id++) {
+        int num_free_cores = num_cores[socket_id];
+        int last = -1;
+
+        for (;;) {
+            int next = -1;
+
+            /* Next process of the socket, ties by process index */
+            for (int i = 0; i < num_processes; i++) {
+                if (socket_id != socket_ids[i] ||
+                    (-1 != last &&
+                     (processes[i].num_threads <
+                      processes[last].num_threads ||
+                      (processes[i].num_threads ==
+                       processes[last].num_threads && i <= last))))
+                    continue;
+
+                if (-1 == next ||
+                    processes[i].num_threads < processes[next].num_threads)
+                    next = i;
+            }
+
+            if (-1 == next)
+                break;
+
+            if (0 > num_free_cores)
+                return 0;
+
+            num_free_cores -= processes[next].num_threads;
+            if (0 >= num_free_cores)
+                *norme = (INT_MIN == *norme) ?
+                    num_free_cores : *norme + num_free_cores;
+
+            last = next;
+        }
+    }
+
+    return 1;
+}
+
+/* Every solver must reach the optimum of an exhaustive enumeration, the
+ * last socket has num_hidden_cores cores less than the others */
+static void test_oracle(const int num_sockets, const int num_cores_per_socket,
+            const int num_processes, const int first_step,
+            const int num_hidden_cores, const int *move_costs)
+{
+    int *num_cores;
+    int *socket_ids;
+    core_process_t *processes;
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+    num_cores = xzalloc(sizeof(int) * (size_t) num_sockets);
+
+    for (int i = 0; i < num_sockets; i++)
+        num_cores[i] = num_cores_per_socket;
+    num_cores[num_sockets - 1] -= num_hidden_cores;
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_socket_num_cores(num_cores);
+    decision_tree_set_socket_move_costs(move_costs);
+
+    for (unsigned int seed = 0; seed < 8; seed++) {
+        int best_norme = INT_MIN;
+        int best_move_cost = INT_MAX;
+
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, seed, first_step);
+
+        for (int i = 0; i < num_processes; i++)
+            socket_ids[i] = 0;
+
+        for (;;) {
+            int norme;
+            int move_cost;
+            int i = 0;
+
+            if (test_oracle_eval(processes, socket_ids, num_processes,
+                         num_sockets, num_cores, move_costs,
+                         &norme, &move_cost) &&
+                (norme > best_norme ||
+                 (norme == best_norme &&
+                  move_cost < best_move_cost))) {
+                best_norme = norme;
+                best_move_cost = move_cost;
+            }
+
+            while (i < num_processes && num_sockets == ++socket_ids[i])
+                socket_ids[i++] = 0;
+
+            if (num_processes == i)
+                break;
+        }
+
+        for (int j = 0; j < DECISION_TREE_NUM_SOLVERS; j++) {
+            int norme;
+            int move_cost;
+
+            test_init_processes(processes, num_processes, num_sockets,
+                        num_cores_per_socket, seed, first_step);
+            decision_tree_set_solver((enum decision_tree_solver) j);
+            decision_tree_compute_placement(processes);
+
+            for (int i = 0; i < num_processes; i++)
+                socket_ids[i] = processes[i].socket_id;
+
+            /* Socket changes are counted from the requested placement */
+            test_init_processes(processes, num_processes, num_sockets,
+                        num_cores_per_socket, seed, first_step);
+
+            assert(test_oracle_eval(processes, socket_ids, num_processes,
+                        num_sockets, num_cores, move_costs,
+                        &norme, &move_cost));
+            assert(best_norme == norme);
+            assert(best_move_cost == move_cost);
+            (void) norme;
+            (void) move_cost;
+        }
+    }
+
+    decision_tree_fini();
+
+    xfree(num_cores);
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* Two pairs of close sockets, 0 and 1 are the farthest pair */
+static const int test_move_costs[] = {
+    0, 12, 4, 8,
+    12, 0, 8, 4,
+    4, 8, 0, 4,
+    8, 4, 4, 0
+};
+
+/* A process of the full socket 0 moves to the closest free socket */
+static void test_move_costs_placement(void)
+{
+    core_process_t processes[3];
+    const int num_threads[3] = { 4, 4, 4 };
+    const int prev_socket_ids[3] = { 0, 0, 3 };
+
+    memset(processes, 0, sizeof(processes));
+
+    decision_tree_init(4, 4, 3);
+
+    for (int j = 0; j < DECISION_TREE_NUM_SOLVERS; j++) {
+        decision_tree_set_solver((enum decision_tree_solver) j);
+
+        for (int k = 0; k < 2; k++) {
+            decision_tree_set_socket_move_costs((k) ? test_move_costs : NULL);
+
+            for (int i = 0; i < 3; i++) {
+                processes[i].node_rank = i;
+                processes[i].num_threads = num_threads[i];
+                processes[i].prev_socket_id = prev_socket_ids[i];
+                processes[i].socket_id = -1;
+            }
+
+            decision_tree_compute_placement(processes);
+
+            /* Socket 1 is found first with counted socket changes */
+            assert(3 == processes[2].socket_id);
+            assert(0 == processes[0].socket_id || 0 == processes[1].socket_id);
+            assert(((k) ? 2 : 1) == processes[0].socket_id +
+                   processes[1].socket_id);
+        }
+    }
+
+    decision_tree_fini();
+}
+
+/* Solver optimizations keep the placement and cut the explored nodes */
+static void test_flags(const int num_sockets, const int num_cores_per_socket,
+               const int num_processes, const int first_step,
+               const int flags)
+{
+    int *socket_ids;
+    core_process_t *processes;
+    struct decision_tree_stats stats;
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+
+    for (unsigned int seed = 0; seed < 4; seed++) {
+        uint64_t num_nodes;
+
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, seed, first_step);
+        decision_tree_set_flags(0);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        num_nodes = stats.num_nodes;
+
+        for (int i = 0; i < num_processes; i++)
+            socket_ids[i] = processes[i].socket_id;
+
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, seed, first_step);
+        decision_tree_set_flags(flags);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert(stats.num_nodes <= num_nodes);
+        (void) num_nodes;
+
+        for (int i = 0; i < num_processes; i++)
+            assert(socket_ids[i] == processes[i].socket_id);
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* Balancing steps moving one thread from a process to another, every other
+ * step keeps the distribution and reuses the previous placement. Each step
+ * must return the placement of a full search from the previous one */
+static void test_incremental(const int num_sockets,
+                 const int num_cores_per_socket,
+                 const int num_processes, const int num_steps)
+{
+    int *num_threads;
+    int *socket_ids;
+    core_process_t *processes;
+    struct decision_tree_stats stats;
+
+    const size_t size = (size_t) (num_processes * num_steps);
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    num_threads = xzalloc(sizeof(int) * size);
+    socket_ids = xzalloc(sizeof(int) * size);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+    decision_tree_set_flags(DECISION_TREE_FLAGS_DEFAULT);
+
+    test_init_processes(processes, num_processes, num_sockets,
+                num_cores_per_socket, 0, 0);
+
+    for (int step = 0; step < num_steps; step++) {
+        const int src = (step * 7) % num_processes;
+        const int dst = (step * 3 + 1) % num_processes;
+
+        if (step % 2 && 1 < processes[src].num_threads) {
+            processes[src].num_threads--;
+            processes[dst].num_threads++;
+        }
+
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert(0 == stats.num_reuses || 0 == stats.num_nodes);
+        assert(0 == step || step % 2 || 1 == stats.num_reuses);
+
+        for (int i = 0; i < num_processes; i++) {
+            num_threads[step * num_processes + i] = processes[i].num_threads;
+            socket_ids[step * num_processes + i] = processes[i].socket_id;
+        }
+    }
+
+    /* Full searches from the previous step placement */
+    decision_tree_set_flags(DECISION_TREE_FLAGS_DEFAULT &
+                ~DECISION_TREE_FLAG_INCREMENTAL);
+
+    test_init_processes(processes, num_processes, num_sockets,
+                num_cores_per_socket, 0, 0);
+
+    for (int step = 0; step < num_steps; step++) {
+        for (int i = 0; i < num_processes; i++) {
+            processes[i].num_threads = num_threads[step * num_processes + i];
+            if (0 < step)
+                processes[i].prev_socket_id =
+                    socket_ids[(step - 1) * num_processes + i];
+        }
+
+        decision_tree_compute_placement(processes);
+
+        for (int i = 0; i < num_processes; i++)
+            assert(socket_ids[step * num_processes + i] ==
+                   processes[i].socket_id);
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(num_threads);
+    xfree(processes);
+}
+
+/* Budgeted search stops after the budget and is deterministic */
+static void test_budget(const int num_sockets, const int num_cores_per_socket,
+            const int num_processes, const int budget,
+            const enum decision_tree_solver solver)
+{
+    int *socket_ids;
+    core_process_t *processes;
+    struct decision_tree_stats stats;
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_solver(solver);
+    decision_tree_set_num_threads(4);
+    decision_tree_set_budget(budget);
+
+    /* Every budgeted run is a backtracking one */
+    assert(DECISION_TREE_SOLVER_BACKTRACK == decision_tree_get_active_solver());
+
+    for (unsigned int seed = 0; seed < 4; seed++) {
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, seed, 0);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert(stats.num_nodes <= (uint64_t) budget);
+
+        for (int i = 0; i < num_processes; i++) {
+            assert(0 <= processes[i].socket_id &&
+                   num_sockets > processes[i].socket_id);
+            socket_ids[i] = processes[i].socket_id;
+        }
+
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, seed, 0);
+        decision_tree_compute_placement(processes);
+
+        /* A truncated placement is searched again, never reused */
+        decision_tree_get_stats(&stats);
+        assert(0 == stats.num_reuses && 0 == stats.num_cache_hits);
+
+        for (int i = 0; i < num_processes; i++)
+            assert(socket_ids[i] == processes[i].socket_id);
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* Cached placements must match the placements of a full search */
+static void test_cache(const int num_sockets, const int num_cores_per_socket,
+               const int num_processes, const int num_seeds)
+{
+    int *socket_ids;
+    core_process_t *processes;
+    struct decision_tree_stats stats;
+
+    const size_t size = (size_t) (num_processes * num_seeds);
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) num_processes);
+    socket_ids = xzalloc(sizeof(int) * size);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+    decision_tree_set_flags(DECISION_TREE_FLAGS_DEFAULT &
+                ~DECISION_TREE_FLAG_INCREMENTAL);
+    decision_tree_set_cache_size(0);
+
+    for (int seed = 0; seed < num_seeds; seed++) {
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, (unsigned int) seed, 0);
+        decision_tree_compute_placement(processes);
+
+        for (int i = 0; i < num_processes; i++)
+            socket_ids[seed * num_processes + i] = processes[i].socket_id;
+    }
+
+    decision_tree_set_cache_size(num_seeds);
+
+    for (int round = 0; round < 3; round++) {
+        for (int seed = 0; seed < num_seeds; seed++) {
+            const int hit = (0 < round);
+
+            test_init_processes(processes, num_processes, num_sockets,
+                        num_cores_per_socket, (unsigned int) seed, 0);
+            decision_tree_compute_placement(processes);
+
+            decision_tree_get_stats(&stats);
+            assert((uint64_t) hit == stats.num_cache_hits);
+            assert(!hit || 0 == stats.num_nodes);
+            (void) hit;
+
+            for (int i = 0; i < num_processes; i++)
+                assert(socket_ids[seed * num_processes + i] ==
+                       processes[i].socket_id);
+        }
+    }
+
+    /* A new input evicts the least recently used first seed only */
+    test_init_processes(processes, num_processes, num_sockets,
+                num_cores_per_socket, (unsigned int) num_seeds, 0);
+    decision_tree_compute_placement(processes);
+
+    for (int seed = num_seeds - 1; seed >= 0; seed--) {
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, (unsigned int) seed, 0);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert((uint64_t) (0 != seed) == stats.num_cache_hits);
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* A tree placing fewer processes than it was initialized for gives the
+ * placement of a tree of that size, and keeps the cached placements */
+static void test_num_processes(const int num_sockets,
+                   const int num_cores_per_socket,
+                   const int num_processes)
+{
+    int *socket_ids;
+    core_process_t *processes;
+    struct decision_tree_stats stats;
+
+    const int max_processes = num_processes + num_sockets - 1;
+
+    processes = xzalloc(sizeof(core_process_t) * (size_t) max_processes);
+    socket_ids = xzalloc(sizeof(int) * (size_t) num_processes);
+
+    decision_tree_init(num_sockets, num_cores_per_socket, num_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+    decision_tree_set_budget(0);
+    decision_tree_set_cache_size(0);
+
+    test_init_processes(processes, num_processes, num_sockets,
+                num_cores_per_socket, 1, 0);
+    decision_tree_compute_placement(processes);
+
+    for (int i = 0; i < num_processes; i++)
+        socket_ids[i] = processes[i].socket_id;
+
+    decision_tree_fini();
+
+    decision_tree_init(num_sockets, num_cores_per_socket, max_processes);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_BACKTRACK);
+    decision_tree_set_num_threads(1);
+    decision_tree_set_budget(0);
+    decision_tree_set_cache_size(4);
+    decision_tree_set_flags(DECISION_TREE_FLAGS_DEFAULT &
+                ~DECISION_TREE_FLAG_INCREMENTAL);
+
+    for (int round = 0; round < 2; round++) {
+        decision_tree_set_num_processes(num_processes);
+
+        test_init_processes(processes, num_processes, num_sockets,
+                    num_cores_per_socket, 1, 0);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert((uint64_t) round == stats.num_cache_hits);
+
+        for (int i = 0; i < num_processes; i++)
+            assert(socket_ids[i] == processes[i].socket_id);
+
+        /* Another number of processes never hits the same entry */
+        decision_tree_set_num_processes(max_processes);
+
+        test_init_processes(processes, max_processes, num_sockets,
+                    num_cores_per_socket, 1, 0);
+        decision_tree_compute_placement(processes);
+
+        decision_tree_get_stats(&stats);
+        assert((uint64_t) round == stats.num_cache_hits);
+    }
+
+    decision_tree_fini();
+
+    xfree(socket_ids);
+    xfree(processes);
+}
+
+/* The automatic solver follows the socket core counts and the budget */
+static void test_auto_solver(void)
+{
+    const int num_cores[3] = { 64, 16, 16 };
+
+    decision_tree_init(3, 64, 64);
+    decision_tree_set_solver(DECISION_TREE_SOLVER_AUTO);
+    decision_tree_set_budget(0);
+
+    /* 64 * 66 * 66 states are too many for the exact solver */
+    assert(DECISION_TREE_SOLVER_BACKTRACK == decision_tree_get_active_solver());
+
+    decision_tree_set_socket_num_cores(num_cores);
+    assert(DECISION_TREE_SOLVER_DP == decision_tree_get_active_solver());
+
+    decision_tree_set_budget(100);
+    assert(DECISION_TREE_SOLVER_BACKTRACK == decision_tree_get_active_solver());
+
+    decision_tree_set_budget(0);
+    assert(DECISION_TREE_SOLVER_DP == decision_tree_get_active_solver());
+    assert(DECISION_TREE_SOLVER_AUTO == decision_tree_get_solver());
+
+    decision_tree_fini();
+}
+
 int main(int argc, char *argv[])
 {
     /* Silent unsued main arguments */
     UNUSED(argc);
     UNUSED(argv);
 
+    /* Allow SABO_LOG_DEBUG perf output */
+    env_get_log_debug();
+
     test_article_example();
 
     test_article_milan64_4ppn_1node();
 
+    test_solvers(2, 24, 8);
+    test_solvers(4, 8, 10);
+
+    test_oracle(2, 8, 6, 0, 0, NULL);
+    test_oracle(3, 4, 7, 0, 0, NULL);
+    test_oracle(3, 6, 6, 1, 0, NULL);
+    test_oracle(2, 8, 6, 0, 3, NULL);
+    test_oracle(3, 6, 6, 1, 2, NULL);
+    test_oracle(4, 3, 6, 0, 0, test_move_costs);
+    test_oracle(4, 4, 6, 0, 2, test_move_costs);
+
+    test_num_processes(4, 8, 10);
+    test_auto_solver();
+
+    test_move_costs_placement();
+
+    test_flags(4, 8, 10, 0, DECISION_TREE_FLAG_SYMMETRY);
+    test_flags(4, 8, 10, 1, DECISION_TREE_FLAG_SYMMETRY);
+    test_flags(4, 8, 10, 0, DECISION_TREE_FLAG_TRANSPOSITION);
+    test_flags(4, 8, 10, 0, DECISION_TREE_FLAG_BOUND);
+    test_flags(4, 8, 10, 1, DECISION_TREE_FLAG_BOUND);
+    test_flags(2, 32, 12, 0, DECISION_TREE_FLAG_BOUND);
+    test_flags(4, 8, 10, 0, DECISION_TREE_FLAGS_DEFAULT);
+    test_flags(4, 8, 10, 1, DECISION_TREE_FLAGS_DEFAULT);
+
+    test_incremental(4, 8, 10, 16);
+    test_incremental(2, 32, 12, 16);
+
+    test_budget(4, 8, 10, 1, DECISION_TREE_SOLVER_BACKTRACK);
+    test_budget(4, 32, 16, 1000, DECISION_TREE_SOLVER_BACKTRACK);
+    test_budget(4, 32, 16, 1000, DECISION_TREE_SOLVER_COPY);
+    test_budget(4, 32, 16, 1000, DECISION_TREE_SOLVER_DP);
+
+    test_cache(4, 8, 10, 4);
+    test_cache(2, 32, 12, 4);
+
     printf("all done\n");
     return EXIT_SUCCESS;
 }
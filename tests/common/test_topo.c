@@ -4,14 +4,378 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <libgen.h>
+#include <assert.h>
 
 #include "topo.h"
 #include "sys.h"
 
+#define TEST_NUM_PROCESSES 5
+
+/* Local core id of a socket core */
+static int test_get_local_core_id(const int socket_id, const int core_id)
+{
+    for (int i = 0; i < topo_get_num_cores_per_socket(); i++) {
+        if (core_id == topo_get_socket_core_id(socket_id, i))
+            return i;
+    }
+
+    return -1;
+}
+
+/* Number of domains of a level used by a process */
+static int test_count_domains(const int socket_id, const int level,
+                  const int *core_ids, const int num_threads)
+{
+    int count = 0;
+    int used[64];
+
+    memset(used, 0, sizeof(used));
+
+    for (int i = 0; i < num_threads; i++) {
+        const int local = test_get_local_core_id(socket_id, core_ids[i]);
+        const int domain_id = topo_get_socket_domain_id(socket_id, level,
+                                local);
+        assert(0 <= local);
+        assert(64 > domain_id);
+
+        if (!used[domain_id])
+            count++;
+        used[domain_id] = 1;
+    }
+
+    return count;
+}
+
+/* 2 sockets of 2 NUMA nodes of 2 L3 caches of 4 cores */
+static void test_layout(void)
+{
+    int offset = 0;
+    int used[16];
+    int core_ids[16];
+    const int num_threads[TEST_NUM_PROCESSES] = { 4, 4, 3, 3, 2 };
+
+    assert(2 == topo_get_num_sockets());
+    assert(16 == topo_get_num_cores_per_socket());
+    assert(TOPO_NUM_LEVELS == topo_get_depth());
+
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        assert(2 == topo_get_socket_num_domains(i, TOPO_LEVEL_NUMA));
+        assert(4 == topo_get_socket_num_domains(i, TOPO_LEVEL_L3));
+    }
+
+    topo_get_socket_layout(1, TEST_NUM_PROCESSES, num_threads, core_ids);
+
+    /* Every socket core is used once */
+    memset(used, 0, sizeof(used));
+    for (int i = 0; i < 16; i++) {
+        const int local = test_get_local_core_id(1, core_ids[i]);
+        assert(0 <= local);
+        assert(!used[local]);
+        used[local] = 1;
+    }
+
+    for (int i = 0; i < TEST_NUM_PROCESSES; i++) {
+        const int *cores = &(core_ids[offset]);
+        const int num_numa = test_count_domains(1, TOPO_LEVEL_NUMA, cores,
+                            num_threads[i]);
+        const int num_l3 = test_count_domains(1, TOPO_LEVEL_L3, cores,
+                              num_threads[i]);
+
+        assert(1 == num_numa);
+
+        /* The last process fills the holes */
+        assert(1 == num_l3 || TEST_NUM_PROCESSES - 1 == i);
+
+        /* Silent unused values without asserts */
+        (void) num_numa;
+        (void) num_l3;
+
+        offset += num_threads[i];
+    }
+}
+
+/* Cores changing owner from one stable layout to the next one, the cores
+ * of each process match its owners */
+static int test_stable_step(const int *keys, const int *num_threads,
+                int *owners)
+{
+    int offset = 0;
+    int num_changes = 0;
+    int prev[16];
+    int core_ids[16];
+
+    memcpy(prev, owners, sizeof(prev));
+
+    topo_get_socket_stable_layout(1, TEST_NUM_PROCESSES, keys, num_threads,
+                      NULL, owners, core_ids);
+
+    for (int i = 0; i < TEST_NUM_PROCESSES; i++) {
+        int count = 0;
+
+        for (int j = 0; j < num_threads[i]; j++) {
+            const int local = test_get_local_core_id(1,
+                                 core_ids[offset + j]);
+            assert(0 <= local);
+            assert(keys[i] == owners[local]);
+
+            /* Silent unused value without asserts */
+            (void) local;
+        }
+
+        for (int j = 0; j < 16; j++)
+            count += (keys[i] == owners[j]) ? 1 : 0;
+        assert(num_threads[i] == count);
+
+        offset += num_threads[i];
+    }
+
+    for (int i = 0; i < 16; i++)
+        num_changes += (prev[i] != owners[i]) ? 1 : 0;
+
+    return num_changes;
+}
+
+/* A process growing by one core only takes the core freed by another one */
+static void test_stable_layout(void)
+{
+    int owners[16];
+    int core_ids[16];
+    int packed[16];
+    int num_changes[4];
+    const int keys[TEST_NUM_PROCESSES] = { 10, 11, 12, 13, 14 };
+    const int num_threads[TEST_NUM_PROCESSES] = { 4, 4, 3, 3, 2 };
+    const int grown[TEST_NUM_PROCESSES] = { 5, 4, 3, 3, 1 };
+    const int shrunk[TEST_NUM_PROCESSES] = { 2, 4, 3, 3, 1 };
+
+    for (int i = 0; i < 16; i++)
+        owners[i] = -1;
+
+    /* Without previous owners the layout is the packed one */
+    topo_get_socket_layout(1, TEST_NUM_PROCESSES, num_threads, packed);
+    topo_get_socket_stable_layout(1, TEST_NUM_PROCESSES, keys, num_threads,
+                      NULL, owners, core_ids);
+    assert(0 == memcmp(packed, core_ids, sizeof(packed)));
+
+    num_changes[0] = test_stable_step(keys, num_threads, owners);
+    num_changes[1] = test_stable_step(keys, grown, owners);
+    num_changes[2] = test_stable_step(keys, shrunk, owners);
+    num_changes[3] = test_stable_step(keys, grown, owners);
+
+    assert(0 == num_changes[0]);
+    assert(1 == num_changes[1]);
+    assert(3 == num_changes[2]);
+    assert(3 == num_changes[3]);
+
+    /* Silent unused values without asserts */
+    (void) num_changes;
+}
+
+/* An oversubscribed socket shares its cores instead of failing: the
+ * largest processes give their cores first and a process without core
+ * runs on the cores of the others */
+static void test_oversubscribed_layout(void)
+{
+    int owners[16];
+    int core_ids[20];
+    int num_owned[3];
+    const int keys[3] = { 10, 11, 12 };
+    const int num_threads[3] = { 10, 8, 1 };
+    int single_keys[20];
+    int single_threads[20];
+
+    for (int i = 0; i < 16; i++)
+        owners[i] = -1;
+
+    topo_get_socket_layout(1, 3, num_threads, core_ids);
+    for (int i = 0; i < 19; i++)
+        assert(0 <= test_get_local_core_id(1, core_ids[i]));
+
+    topo_get_socket_stable_layout(1, 3, keys, num_threads, NULL, owners,
+                      core_ids);
+
+    for (int i = 0, offset = 0; i < 3; i++) {
+        num_owned[i] = 0;
+        for (int j = 0; j < 16; j++)
+            num_owned[i] += (keys[i] == owners[j]) ? 1 : 0;
+
+        /* Extra threads share the cores of their process */
+        for (int j = 0; j < num_threads[i]; j++) {
+            const int local = test_get_local_core_id(1, core_ids[offset + j]);
+            assert(0 <= local && keys[i] == owners[local]);
+            (void) local;
+        }
+        offset += num_threads[i];
+    }
+
+    assert(7 == num_owned[0] && 8 == num_owned[1] && 1 == num_owned[2]);
+
+    /* More processes than socket cores */
+    for (int i = 0; i < 20; i++) {
+        single_keys[i] = i;
+        single_threads[i] = 1;
+    }
+    for (int i = 0; i < 16; i++)
+        owners[i] = -1;
+
+    topo_get_socket_stable_layout(1, 20, single_keys, single_threads, NULL,
+                      owners, core_ids);
+
+    for (int i = 0; i < 20; i++)
+        assert(0 <= test_get_local_core_id(1, core_ids[i]));
+    for (int i = 0; i < 16; i++)
+        assert(4 <= owners[i]);
+
+    /* Silent unused values without asserts */
+    (void) num_owned;
+}
+
+/* Cpus 0 and 31 reserved: the first and last cores of socket 0 are not
+ * usable */
+static void test_reserved(void)
+{
+    assert(14 == topo_get_socket_num_cores(0));
+    assert(16 == topo_get_socket_num_cores(1));
+    assert(30 == topo_get_num_usable_cores());
+
+    assert(2 == topo_get_socket_core_id(0, 0));
+    assert(28 == topo_get_socket_core_id(0, 13));
+    assert(32 == topo_get_socket_core_id(1, 0));
+}
+
+/* Binding masks hold the first cpu of each usable core only */
+static void test_core_masks(void)
+{
+    /* Reserved core 0 and its sibling */
+    assert(NULL == topo_get_core_cpuset(0));
+    assert(NULL == topo_get_core_mask(0));
+    assert(NULL == topo_get_core_cpuset(1));
+
+    for (int i = 0; i < topo_get_num_sockets(); i++) {
+        for (int j = 0; j < topo_get_socket_num_cores(i); j++) {
+            const int core_id = topo_get_socket_core_id(i, j);
+
+            for (int k = 0; k < topo_get_core_num_pus(core_id); k++) {
+                const int pu_id = topo_get_core_pu_id(core_id, k);
+                const cpu_set_t *mask = topo_get_core_mask(pu_id);
+
+                assert(NULL != topo_get_core_cpuset(pu_id));
+                assert(NULL != mask && 1 == CPU_COUNT(mask));
+                assert(CPU_ISSET((size_t) pu_id, mask));
+                (void) mask;
+            }
+        }
+    }
+}
+
+/* Two hardware threads on each core, core j runs cpus 2j and 2j + 1 */
+static void test_smt(void)
+{
+    assert(TOPO_SMT_FILL == topo_get_smt_policy());
+    assert(2 == topo_get_num_smt());
+
+    assert(2 == topo_get_core_num_pus(2));
+    assert(2 == topo_get_core_pu_id(2, 0));
+    assert(3 == topo_get_core_pu_id(2, 1));
+    assert(33 == topo_get_core_pu_id(32, 1));
+}
+
+/* Socket 0 has 7 usable fast and 7 usable slow cores, socket 1 16 medium
+ * cores */
+static void test_capacity(void)
+{
+    assert(TOPO_CAPACITY_SCALE == topo_get_socket_core_capacity(0, 0));
+    assert(TOPO_CAPACITY_SCALE / 2 == topo_get_socket_core_capacity(0, 13));
+    assert(768 == topo_get_socket_core_capacity(1, 0));
+
+    assert(21 * TOPO_CAPACITY_SCALE / 2 == topo_get_socket_capacity(0));
+    assert(12 * TOPO_CAPACITY_SCALE == topo_get_socket_capacity(1));
+}
+
+/* Slow cores of a process on socket 0, see test_capacity */
+static int test_count_slow_cores(const int *core_ids, const int num_threads)
+{
+    int count = 0;
+
+    for (int i = 0; i < num_threads; i++) {
+        const int local = test_get_local_core_id(0, core_ids[i]);
+
+        assert(0 <= local);
+        if (TOPO_CAPACITY_SCALE > topo_get_socket_core_capacity(0, local))
+            count++;
+    }
+
+    return count;
+}
+
+/* The process with the highest priority takes the fastest cores, the
+ * other one completes with slow cores */
+static void test_capacity_layout(void)
+{
+    int owners[14];
+    int core_ids[14];
+    int sorted[14];
+    int num_slow[4];
+    const int keys[2] = { 10, 11 };
+    const int num_threads[2] = { 3, 6 };
+    const int loaded_first[2] = { 6, 2 };
+    const int loaded_last[2] = { 2, 6 };
+
+    topo_get_socket_sorted_cores(0, sorted);
+    assert(TOPO_CAPACITY_SCALE == topo_get_socket_core_capacity(0, sorted[6]));
+    assert(TOPO_CAPACITY_SCALE / 2 ==
+           topo_get_socket_core_capacity(0, sorted[7]));
+
+    for (int i = 0; i < 14; i++)
+        owners[i] = -1;
+
+    topo_get_socket_stable_layout(0, 2, keys, num_threads, loaded_first,
+                      owners, core_ids);
+    num_slow[0] = test_count_slow_cores(core_ids, 3);
+    num_slow[1] = test_count_slow_cores(&(core_ids[3]), 6);
+
+    topo_get_socket_stable_layout(0, 2, keys, num_threads, loaded_last,
+                      owners, core_ids);
+    num_slow[2] = test_count_slow_cores(core_ids, 3);
+    num_slow[3] = test_count_slow_cores(&(core_ids[3]), 6);
+
+    assert(0 == num_slow[0] && 2 == num_slow[1]);
+    assert(2 == num_slow[2] && 0 == num_slow[3]);
+
+    /* Silent unused values without asserts */
+    (void) sorted;
+    (void) num_slow;
+}
+
+/* Synthetic socket distances override the topology ones */
+static void test_distances(void)
+{
+    assert(10 == topo_get_socket_distance(0, 0));
+    assert(32 == topo_get_socket_distance(0, 1));
+    assert(21 == topo_get_socket_distance(1, 0));
+    assert(10 == topo_get_socket_distance(1, 1));
+}
+
 int main(int argc, char *argv[])
 {
+    char *dir;
+    char filename[PATH_MAX];
+
     UNUSED(argc);
-    UNUSED(argv);
+
+    /* Synthetic topology and core capacities next to the test */
+    dir = dirname(argv[0]);
+
+    snprintf(filename, PATH_MAX, "%s/topomilan.xml", dir);
+    setenv("SABO_HWLOC_FILENAME", filename, 1);
+    snprintf(filename, PATH_MAX, "%s/capacitymilan.txt", dir);
+    setenv("SABO_CPU_CAPACITY_FILENAME", filename, 1);
+    setenv("SABO_TOPO_DEPTH", "2", 1);
+    setenv("SABO_RESERVED_CORES", "0,31", 1);
+    setenv("SABO_SMT", "fill", 1);
+    setenv("SABO_SOCKET_DISTANCES", "10,32,21,10", 1);
 
     topo_init();
 
@@ -19,6 +383,27 @@ int main(int argc, char *argv[])
     (void) topo_get_num_cores();
     (void) topo_get_num_cores_per_socket();
 
+    test_reserved();
+    test_core_masks();
+    test_smt();
+    test_layout();
+    test_stable_layout();
+    test_oversubscribed_layout();
+    test_capacity();
+    test_capacity_layout();
+    test_distances();
+
+    topo_fini();
+
+    /* A new topology rebuilds the socket core ids */
+    setenv("SABO_RESERVED_CORES", "31", 1);
+    topo_init();
+
+    assert(15 == topo_get_socket_num_cores(0));
+    assert(0 == topo_get_socket_core_id(0, 0));
+    assert(28 == topo_get_socket_core_id(0, 14));
+    assert(32 == topo_get_socket_core_id(1, 0));
+
     topo_fini();
 
     printf("all done\n");
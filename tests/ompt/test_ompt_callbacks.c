@@ -13,7 +13,13 @@
 #include "sys.h"
 #include "topo.h"
 
-#if defined(SABO_RTINTEL)
+/* Counters exist for the hardware threads of the usable cores only */
+static int test_get_num_threads(const int max_threads)
+{
+    return MIN(max_threads,
+           topo_get_num_usable_cores() * topo_get_num_smt());
+}
+
 static int doubles_are_equal(double val1, double val2)
 {
     double diff = fabs(val1 - val2);
@@ -25,20 +31,21 @@ static int double_is_zero(double val)
     return doubles_are_equal(val, 0.0);
 }
 
-static int test_one_parallel_region_balanced(const int num_threads)
+static int test_one_parallel_region_balanced(const int max_threads)
 {
-    int i, num_cores;
+    int i, num_cores, num_threads;
 
     print("%s: start", __func__);
 
     print("%s: warmup", __func__);
     /* warmup - force first parallel region */
-    #pragma omp parallel num_threads(num_threads)
+    #pragma omp parallel num_threads(max_threads)
     {
         sleep(1);
     }
 
     num_cores = topo_get_num_cores();
+    num_threads = test_get_num_threads(max_threads);
 
     /* Reset ompt counters */
     sabo_core_reset_ompt_data();
@@ -79,21 +86,22 @@ static int test_one_parallel_region_balanced(const int num_threads)
     return 0;
 }
 
-static int test_one_parallel_region_unbalanced(const int num_threads)
+static int test_one_parallel_region_unbalanced(const int max_threads)
 {
-    int i, num_cores;
+    int i, num_cores, num_threads;
 
     print("%s: start", __func__);
 
     print("%s: warmup", __func__);
 
     /* warmup - force first parallel region */
-    #pragma omp parallel num_threads(num_threads)
+    #pragma omp parallel num_threads(max_threads)
     {
         sleep(1);
     }
 
     num_cores = topo_get_num_cores();
+    num_threads = test_get_num_threads(max_threads);
 
     /* Reset ompt counters */
     sabo_core_reset_ompt_data();
@@ -136,21 +144,22 @@ static int test_one_parallel_region_unbalanced(const int num_threads)
     return 0;
 }
 
-static int test_two_parallel_region_balanced(const int num_threads)
+static int test_two_parallel_region_balanced(const int max_threads)
 {
-    int i, num_cores;
+    int i, num_cores, num_threads;
 
     print("%s: start", __func__);
 
     print("%s: warmup", __func__);
 
     /* warmup - force first parallel region */
-    #pragma omp parallel num_threads(num_threads)
+    #pragma omp parallel num_threads(max_threads)
     {
         sleep(1);
     }
 
     num_cores = topo_get_num_cores();
+    num_threads = test_get_num_threads(max_threads);
 
     /* Reset ompt counters */
     sabo_core_reset_ompt_data();
@@ -195,13 +204,11 @@ static int test_two_parallel_region_balanced(const int num_threads)
 
     return 0;
 }
-#endif /* #if defined(SABO_RTINTEL) */
 
 int main(int argc, char *argv[])
 {
     UNUSED(argc);
     UNUSED(argv);
-#if defined(SABO_RTINTEL)
     if (0 > test_one_parallel_region_balanced(4))
         return EXIT_FAILURE;
 
@@ -212,8 +219,4 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
-#else /* #if defined(SABO_RTINTEL) */
-    print("Define SABO_RTINTEL to enable this tests");
-    return EXIT_SUCCESS;
-#endif /* #if defined(SABO_RTINTEL) */
 }